@@ -0,0 +1,36 @@
+#include <allocs.h>
+#include <stdatomic.h>
+
+_Thread_local size_t allocs_thread = 0;
+static atomic_size_t allocs_all = 0;
+
+#ifdef ALLOCS_WRAP_MALLOC
+// With -Wl,--wrap, every call to these in the program comes here first, so allocations can be counted per thread
+// (for the stages of --stats) and in total (for benchmarks whose work is spread over threads)
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocs_thread++;
+    atomic_fetch_add_explicit(&allocs_all, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocs_thread++;
+    atomic_fetch_add_explicit(&allocs_all, 1, memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocs_thread++;
+    atomic_fetch_add_explicit(&allocs_all, 1, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+#endif
+
+/// Returns the number of allocations made by every thread since the program started
+size_t allocs_total() {
+    return atomic_load_explicit(&allocs_all, memory_order_relaxed);
+}
@@ -0,0 +1,13 @@
+#ifndef __ALLOCS_H__
+#define __ALLOCS_H__
+
+#include <stddef.h>
+
+/// Number of allocations made by this thread. Only counted when the program is linked with
+/// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc and allocs.c is built with ALLOCS_WRAP_MALLOC (as the makefile does)
+extern _Thread_local size_t allocs_thread;
+
+/// Returns the number of allocations made by every thread since the program started (counted the same way)
+size_t allocs_total();
+
+#endif // __ALLOCS_H__
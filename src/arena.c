@@ -0,0 +1,120 @@
+#include <arena.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Every allocation is rounded up to a multiple of this, so the next one stays aligned
+#define ARENA_ALIGN 16
+
+// The data of each block starts after its header, rounded up to keep it aligned
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/// Creates a new, empty arena which gets memory from malloc in blocks of (at least) block_size bytes
+Arena* arena_create(size_t block_size) {
+    Arena *arena;
+
+    arena = (Arena*)malloc(sizeof(Arena));
+    arena->blocks = NULL;
+    arena->current = NULL;
+    arena->block_size = block_size;
+
+    return arena;
+}
+
+/// Allocates size bytes from the arena, aligned for any of the types in a bitstream or frame
+void* arena_alloc(Arena *arena, size_t size) {
+    ArenaBlock *block;
+    size_t block_size;
+    void *ptr;
+
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    // Move on through the blocks kept from before the last reset, until one has room
+    while (arena->current && arena->current->used + size > arena->current->size && arena->current->next) {
+        arena->current = arena->current->next;
+        arena->current->used = 0;
+    }
+
+    // Out of blocks, so get a new one big enough for this allocation, after the current one
+    if (!arena->current || arena->current->used + size > arena->current->size) {
+        block_size = size > arena->block_size ? size : arena->block_size;
+        block = (ArenaBlock*)malloc(ARENA_HEADER_SIZE + block_size);
+        block->size = block_size;
+        block->used = 0;
+
+        if (arena->current) {
+            block->next = arena->current->next;
+            arena->current->next = block;
+        } else {
+            block->next = NULL;
+            arena->blocks = block;
+        }
+        arena->current = block;
+    }
+
+    ptr = (unsigned char*)arena->current + ARENA_HEADER_SIZE + arena->current->used;
+    arena->current->used += size;
+
+    return ptr;
+}
+
+/// Frees everything allocated from the arena at once. The blocks are kept to be reused by later allocations
+void arena_reset(Arena *arena) {
+    // Later blocks are cleared as arena_alloc reaches them
+    arena->current = arena->blocks;
+    if (arena->current) {
+        arena->current->used = 0;
+    }
+}
+
+/// Frees the arena, and everything allocated from it
+void arena_destroy(Arena *arena) {
+    ArenaBlock *block, *next;
+
+    for (block = arena->blocks; block; block = next) {
+        next = block->next;
+        free(block);
+    }
+
+    free(arena);
+}
+
+/// Tests all arena functions
+void arena_test() {
+    Arena *arena;
+    unsigned char *first, *ptr, *big, *again;
+    size_t i, round;
+
+    printf("  => Testing arena functions\n");
+
+    arena = arena_create(1024);
+
+    for (round = 0; round < 3; round++) {
+        // Small allocations are aligned, and don't overlap
+        first = (unsigned char*)arena_alloc(arena, 1);
+        for (i = 0; i < 200; i++) {
+            ptr = (unsigned char*)arena_alloc(arena, i % 40 + 1);
+            assert((uintptr_t)ptr % ARENA_ALIGN == 0);
+            ptr[0] = (unsigned char)i;
+            ptr[i % 40] = (unsigned char)i;
+        }
+
+        // Allocations bigger than a block get a block of their own
+        big = (unsigned char*)arena_alloc(arena, 5000);
+        assert((uintptr_t)big % ARENA_ALIGN == 0);
+        for (i = 0; i < 5000; i++) {
+            big[i] = (unsigned char)i;
+        }
+
+        // After a reset the same memory gets handed out again
+        arena_reset(arena);
+        again = (unsigned char*)arena_alloc(arena, 1);
+        assert(again == first);
+        arena_reset(arena);
+    }
+
+    arena_destroy(arena);
+
+    printf("    => Arena tests passed!\n");
+}
@@ -0,0 +1,38 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/// Default size of each block an arena gets from malloc
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;        // Bytes of data in the block
+    size_t used;        // Bytes of data handed out since the last reset
+} ArenaBlock;
+
+/// A region that hands out memory from large blocks, so a batch of objects can be freed with one arena_reset
+/// instead of one free each. Objects allocated from an arena must not be passed to their destroy functions.
+typedef struct {
+    ArenaBlock *blocks;     // Every block owned by the arena
+    ArenaBlock *current;    // The block allocations are currently coming from
+    size_t block_size;
+} Arena;
+
+/// Creates a new, empty arena which gets memory from malloc in blocks of (at least) block_size bytes
+Arena* arena_create(size_t block_size);
+
+/// Allocates size bytes from the arena, aligned for any of the types in a bitstream or frame
+void* arena_alloc(Arena *arena, size_t size);
+
+/// Frees everything allocated from the arena at once. The blocks are kept to be reused by later allocations
+void arena_reset(Arena *arena);
+
+/// Frees the arena, and everything allocated from it
+void arena_destroy(Arena *arena);
+
+/// Tests all arena functions
+void arena_test();
+
+#endif // __ARENA_H__
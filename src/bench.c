@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <allocs.h>
+#include <bitstream.h>
+#include <crc.h>
+#include <hamming.h>
+
+// Number of times each measurement is repeated (the fastest run is reported)
+#define BENCH_REPEATS 3
+// Minimum time a measurement should run for, so that small inputs are timed over many operations
+#define BENCH_MIN_SECONDS 0.05
+// Each message size in the sweep is this many times the previous one
+#define BENCH_SIZE_STEP 8
+// Smallest message size in the sweep, in bits
+#define BENCH_MIN_BITS 8
+
+/// Everything a benchmarked operation might work on. Each group of benchmarks fills in the parts it needs
+typedef struct {
+    BitStream *input, *other;
+    HammingFrame *frame;
+    BitStream *decoded;
+    CRCTable *table;
+    BitStream *generator;
+    CRCFrame *crc_frame;
+    size_t threads;
+    size_t error_bit;
+} BenchState;
+
+/// A single operation to time
+typedef void (*BenchOp)(BenchState *state);
+
+/// Returns the current time in seconds, from a monotonic clock
+static double bench_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// State of the random number generator used to fill inputs
+static uint64_t bench_seed = 4220;
+
+/// Returns the next 64 random bits (splitmix64, which is much faster than rand() for filling gigabytes)
+static uint64_t bench_random() {
+    uint64_t z;
+
+    z = (bench_seed += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+    return z ^ (z >> 31);
+}
+
+/// Creates a bitstream of the given number of bits filled with random data
+static BitStream* bench_random_stream(size_t nbits) {
+    BitStream *stream;
+    size_t i;
+
+    stream = bitstream_create(nbits);
+    for (i = 0; i < BITSTREAM_WORDS(nbits); i++) {
+        stream->words[i] = bench_random();
+    }
+
+    // Keep the bits past the end of the stream clear
+    if (nbits % BITSTREAM_WORD_BITS) {
+        stream->words[nbits / BITSTREAM_WORD_BITS] &= ((uint64_t)1 << (nbits % BITSTREAM_WORD_BITS)) - 1;
+    }
+
+    return stream;
+}
+
+/// Creates a random generator of the given length, with its first and last bits set
+static BitStream* bench_random_generator(size_t nbits) {
+    BitStream *generator;
+
+    generator = bench_random_stream(nbits);
+    bitstream_set(generator, 0, 1);
+    bitstream_set(generator, nbits - 1, 1);
+
+    return generator;
+}
+
+/// Times op on a message of `bits` bits and prints a CSV row: the operation is run enough times to take at least
+/// BENCH_MIN_SECONDS, and the fastest of BENCH_REPEATS such runs is reported
+static void bench_measure(const char *name, size_t generator_bits, size_t threads, size_t bits, BenchOp op,
+                          BenchState *state) {
+    size_t iterations, repeat, i, allocs;
+    double start, elapsed, best;
+
+    // Grow the iteration count until a run is long enough to time (that run counts as the first repeat)
+    iterations = 1;
+    for (;;) {
+        allocs = allocs_total();
+        start = bench_now();
+        for (i = 0; i < iterations; i++) {
+            op(state);
+        }
+        elapsed = bench_now() - start;
+        allocs = allocs_total() - allocs;
+
+        if (elapsed >= BENCH_MIN_SECONDS) {
+            break;
+        }
+        iterations = elapsed > 0 && BENCH_MIN_SECONDS / elapsed < 100
+            ? (size_t)(iterations * BENCH_MIN_SECONDS * 1.2 / elapsed) + 1
+            : iterations * 100;
+    }
+
+    best = elapsed;
+    for (repeat = 1; repeat < BENCH_REPEATS; repeat++) {
+        start = bench_now();
+        for (i = 0; i < iterations; i++) {
+            op(state);
+        }
+        elapsed = bench_now() - start;
+
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    // Bits per nanosecond is the same as gigabits per second
+    printf("%s,%zu,%zu,%zu,%zu,%.2f,%.3f,%.2f\n", name, generator_bits, threads, bits, iterations,
+           best / iterations * 1e9, bits / (best / iterations * 1e9), (double)allocs / iterations);
+    fflush(stdout);
+}
+
+/// Checks whether a benchmark was selected by the filter given on the command line (a prefix of its name)
+static int bench_selected(const char *filter, const char *name) {
+    return !filter || strncmp(name, filter, strlen(filter)) == 0;
+}
+
+/// Checks whether any benchmark in a group (whose names all start with the given prefix) could be selected by the
+/// filter, so that groups nothing will be run from can skip setting up their inputs
+static int bench_group_selected(const char *filter, const char *prefix) {
+    size_t length;
+
+    if (!filter) {
+        return 1;
+    }
+
+    length = strlen(filter) < strlen(prefix) ? strlen(filter) : strlen(prefix);
+    return strncmp(filter, prefix, length) == 0;
+}
+
+static void bench_op_copy(BenchState *state) {
+    bitstream_destroy(bitstream_copy(state->input, state->input->length));
+}
+
+static void bench_op_xor(BenchState *state) {
+    bitstream_xor(state->other, state->input);
+}
+
+static void bench_op_shift(BenchState *state) {
+    bitstream_shift(state->other, 13);
+}
+
+static void bench_op_copy_bits(BenchState *state) {
+    bitstream_copy_bits(state->other, 3, state->input, 0, state->input->length - 3);
+}
+
+static void bench_op_hamming_encode(BenchState *state) {
+    hamming_destroy(hamming_encode(state->input));
+}
+
+static void bench_op_hamming_encode_into(BenchState *state) {
+    hamming_encode_into(state->input, state->frame->frame_stream);
+}
+
+static void bench_op_hamming_fix_errors(BenchState *state) {
+    // Flip a different bit each time, so every call has an error to find and correct
+    bitstream_toggle(state->frame->frame_stream, state->error_bit);
+    state->error_bit = (state->error_bit + 7919) % state->frame->frame_bits;
+    hamming_fix_errors(state->frame);
+}
+
+static void bench_op_hamming_decode(BenchState *state) {
+    bitstream_destroy(hamming_decode(state->frame));
+}
+
+static void bench_op_hamming_decode_into(BenchState *state) {
+    hamming_decode_into(state->frame->frame_stream, state->decoded);
+}
+
+static void bench_op_hamming_set_data_bit(BenchState *state) {
+    // Edit a different message bit each time, which changes it about half the time
+    hamming_set_data_bit(state->frame, state->error_bit, state->error_bit & 1);
+    state->error_bit = (state->error_bit + 7919) % state->input->length;
+}
+
+static void bench_op_crc_encode(BenchState *state) {
+    crc_destroy(crc_encode(state->input, state->generator));
+}
+
+static void bench_op_crc_encode_table(BenchState *state) {
+    crc_destroy(crc_encode_table(state->input, state->table));
+}
+
+static void bench_op_crc_update_bits(BenchState *state) {
+    // Patch a different message bit each time, and bring the remainder up to date without going over the message
+    bitstream_toggle(state->crc_frame->frame_stream, state->error_bit);
+    crc_update_bits(state->crc_frame, state->table, &state->error_bit, 1);
+    state->error_bit = (state->error_bit + 7919) % state->input->length;
+}
+
+static void bench_op_crc_encode_parallel(BenchState *state) {
+    crc_destroy(crc_encode_parallel(state->input, state->table, state->threads));
+}
+
+/// Measures the bitstream primitives on a message of the given size
+static void bench_bitstream(const char *filter, size_t bits) {
+    BenchState state;
+
+    if (!bench_group_selected(filter, "bitstream")) {
+        return;
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.input = bench_random_stream(bits);
+    state.other = bench_random_stream(bits);
+
+    if (bench_selected(filter, "bitstream_copy")) {
+        bench_measure("bitstream_copy", 0, 1, bits, bench_op_copy, &state);
+    }
+    if (bench_selected(filter, "bitstream_xor")) {
+        bench_measure("bitstream_xor", 0, 1, bits, bench_op_xor, &state);
+    }
+    if (bench_selected(filter, "bitstream_shift")) {
+        bench_measure("bitstream_shift", 0, 1, bits, bench_op_shift, &state);
+    }
+    if (bench_selected(filter, "bitstream_copy_bits")) {
+        bench_measure("bitstream_copy_bits", 0, 1, bits, bench_op_copy_bits, &state);
+    }
+
+    bitstream_destroy(state.other);
+    bitstream_destroy(state.input);
+}
+
+/// Measures hamming encoding, error correction, single bit edits and decoding on a message of the given size
+static void bench_hamming(const char *filter, size_t bits) {
+    BenchState state;
+
+    if (!bench_group_selected(filter, "hamming")) {
+        return;
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.input = bench_random_stream(bits);
+    state.frame = hamming_encode(state.input);
+    state.decoded = bitstream_create(bits);
+
+    if (bench_selected(filter, "hamming_encode")) {
+        bench_measure("hamming_encode", 0, 1, bits, bench_op_hamming_encode, &state);
+    }
+    if (bench_selected(filter, "hamming_encode_into")) {
+        bench_measure("hamming_encode_into", 0, 1, bits, bench_op_hamming_encode_into, &state);
+    }
+    if (bench_selected(filter, "hamming_fix_errors")) {
+        bench_measure("hamming_fix_errors", 0, 1, bits, bench_op_hamming_fix_errors, &state);
+    }
+    if (bench_selected(filter, "hamming_set_data_bit")) {
+        state.error_bit = 0;
+        bench_measure("hamming_set_data_bit", 0, 1, bits, bench_op_hamming_set_data_bit, &state);
+    }
+    if (bench_selected(filter, "hamming_decode")) {
+        bench_measure("hamming_decode", 0, 1, bits, bench_op_hamming_decode, &state);
+    }
+    if (bench_selected(filter, "hamming_decode_into")) {
+        bench_measure("hamming_decode_into", 0, 1, bits, bench_op_hamming_decode_into, &state);
+    }
+
+    bitstream_destroy(state.decoded);
+    hamming_destroy(state.frame);
+    bitstream_destroy(state.input);
+}
+
+/// Measures crc encoding on a message of the given size, and updating its frame after a single bit edit, for each of
+/// the common remainder widths (and one that needs more than a word)
+static void bench_crc(const char *filter, size_t bits) {
+    static const size_t widths[] = { 8, 16, 32, 64, 128 };
+    BenchState state;
+    size_t i;
+
+    if (!bench_group_selected(filter, "crc_encode") && !bench_group_selected(filter, "crc_update_bits")) {
+        return;
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.input = bench_random_stream(bits);
+
+    for (i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+        state.generator = bench_random_generator(widths[i] + 1);
+        state.table = crc_table_create(state.generator);
+
+        if (bench_selected(filter, "crc_encode")) {
+            bench_measure("crc_encode", widths[i] + 1, 1, bits, bench_op_crc_encode, &state);
+        }
+        if (bench_selected(filter, "crc_encode_table")) {
+            bench_measure("crc_encode_table", widths[i] + 1, 1, bits, bench_op_crc_encode_table, &state);
+        }
+        if (bench_selected(filter, "crc_update_bits")) {
+            state.crc_frame = crc_encode_table(state.input, state.table);
+            state.error_bit = 0;
+            bench_measure("crc_update_bits", widths[i] + 1, 1, bits, bench_op_crc_update_bits, &state);
+            crc_destroy(state.crc_frame);
+        }
+
+        crc_table_destroy(state.table);
+        bitstream_destroy(state.generator);
+    }
+
+    bitstream_destroy(state.input);
+}
+
+/// Measures crc_encode_parallel throughput for each power of two thread count up to max_threads
+static void bench_crc_threads(const char *filter, size_t bits, size_t max_threads, size_t generator_length) {
+    BenchState state;
+
+    if (!bench_group_selected(filter, "crc_encode_parallel")) {
+        return;
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.input = bench_random_stream(bits);
+    state.generator = bench_random_generator(generator_length);
+    state.table = crc_table_create(state.generator);
+
+    for (state.threads = 1; state.threads <= max_threads; state.threads *= 2) {
+        bench_measure("crc_encode_parallel", generator_length, state.threads, bits, bench_op_crc_encode_parallel,
+                      &state);
+    }
+
+    crc_table_destroy(state.table);
+    bitstream_destroy(state.generator);
+    bitstream_destroy(state.input);
+}
+
+/// Runs the benchmarks: bench [max megabytes] [max threads] [benchmark name prefix]
+///
+/// Every benchmark is run on messages from BENCH_MIN_BITS bits up to the given size, growing BENCH_SIZE_STEP times
+/// each step, and one CSV row is printed per benchmark and size
+int main(int argc, char **argv) {
+    size_t megabytes, max_threads, max_bits, bits;
+    const char *filter;
+
+    megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 1024;
+    max_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+    filter = argc > 3 ? argv[3] : NULL;
+    max_bits = megabytes > 0 ? megabytes << 23 : BENCH_MIN_BITS;
+
+    printf("benchmark,generator_bits,threads,bits,iterations,ns_per_op,gbit_per_s,allocs_per_op\n");
+
+    for (bits = BENCH_MIN_BITS; bits <= max_bits; bits *= BENCH_SIZE_STEP) {
+        bench_bitstream(filter, bits);
+        bench_hamming(filter, bits);
+        bench_crc(filter, bits);
+    }
+
+    bench_crc_threads(filter, max_bits, max_threads, 33);
+
+    return 0;
+}
@@ -0,0 +1,323 @@
+#include <bitio.h>
+#include <assert.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+/// Grows a buffer stream to hold at least nbits bits, keeping what's already in it
+static void bitio_reserve(BitStream *stream, size_t *capacity, size_t nbits) {
+    size_t new_capacity;
+
+    if (BITSTREAM_WORDS(nbits) + 1 > *capacity) {
+        new_capacity = 2 * (BITSTREAM_WORDS(nbits) + 1);
+        stream->words = (uint64_t*)realloc(stream->words, new_capacity * sizeof(uint64_t));
+        memset(stream->words + *capacity, 0, (new_capacity - *capacity) * sizeof(uint64_t));
+        *capacity = new_capacity;
+    }
+}
+
+/// Grows a character buffer to hold at least size chars, keeping what's already in it
+static void bitio_reserve_text(char **text, size_t *capacity, size_t size) {
+    if (size > *capacity) {
+        *capacity = 2 * size;
+        *text = (char*)realloc(*text, *capacity);
+    }
+}
+
+/// Parses the name of a data format (ascii, bin or hex). Returns 0 on success, or -1 if it isn't a known format
+int bitio_parse_format(const char *name, DataFormat *format) {
+    if (!strcmp(name, "ascii")) {
+        *format = FORMAT_ASCII;
+    } else if (!strcmp(name, "bin")) {
+        *format = FORMAT_BIN;
+    } else if (!strcmp(name, "hex")) {
+        *format = FORMAT_HEX;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+/// Starts reading up to limit bits (SIZE_MAX for no limit) from a file in the given format
+void bitreader_init(BitReader *reader, FILE *file, DataFormat format, size_t limit) {
+    memset(reader, 0, sizeof(BitReader));
+    reader->file = file;
+    reader->format = format;
+    reader->remaining = limit;
+}
+
+/// Reads more of the file, adding at most missing bits to the end of reader->bits (fewer if the file ends, or the
+/// data read was whitespace). Returns 0 on success, or -1 if the data wasn't valid
+static int bitreader_fill(BitReader *reader, size_t missing) {
+    BitStream parsed;
+    size_t want, got, length, nbits, i, j;
+    int result;
+
+    // Read as much of the file as the missing bits take up in the format
+    if (reader->format == FORMAT_BIN) {
+        want = BITSTREAM_BYTES(missing);
+    } else if (reader->format == FORMAT_HEX) {
+        want = 2 * BITSTREAM_BYTES(missing);
+    } else {
+        want = missing;
+    }
+
+    // Binary data is read straight into a buffer that can be used as a bitstream, so it has to be whole words
+    bitio_reserve_text(&reader->raw, &reader->raw_capacity,
+                       (reader->raw_length + want + sizeof(uint64_t)) & ~(sizeof(uint64_t) - 1));
+    got = fread(reader->raw + reader->raw_length, 1, want, reader->file);
+    if (got < want) {
+        reader->eof = 1;
+    }
+    length = reader->raw_length + got;
+
+    if (reader->format == FORMAT_BIN) {
+        parsed.bytes = (unsigned char*)reader->raw;
+        nbits = got * 8;
+        result = 0;
+    } else {
+        // Text can be split over lines, or end with a new line
+        for (i = 0, j = 0; i < length; i++) {
+            if (!isspace((unsigned char)reader->raw[i])) {
+                reader->raw[j++] = reader->raw[i];
+            }
+        }
+        length = j;
+
+        // Hex digits come in pairs, so an odd one out has to wait for the next read (or is an error at the end)
+        if (reader->format == FORMAT_HEX && length % 2 && reader->eof) {
+            return -1;
+        }
+        nbits = reader->format == FORMAT_HEX ? (length & ~(size_t)1) * 4 : length;
+
+        // The text is parsed into the end of the raw buffer, after the text itself
+        bitio_reserve_text(&reader->raw, &reader->raw_capacity,
+                           ((length + sizeof(uint64_t)) & ~(sizeof(uint64_t) - 1)) + BITSTREAM_BYTES(nbits) +
+                           sizeof(uint64_t));
+        parsed.bytes = (unsigned char*)reader->raw + ((length + sizeof(uint64_t)) & ~(sizeof(uint64_t) - 1));
+        bitstream_init(&parsed, parsed.words, nbits);
+        if (reader->format == FORMAT_HEX) {
+            result = bitstream_read_from_hex(&parsed, reader->raw, length & ~(size_t)1);
+        } else {
+            result = bitstream_read_from_chars(&parsed, reader->raw, length);
+        }
+    }
+    if (result < 0) {
+        return -1;
+    }
+    parsed.length = nbits;
+
+    bitio_reserve(&reader->bits, &reader->bits_capacity, reader->bits.length + nbits);
+    bitstream_copy_bits(&reader->bits, reader->bits.length, &parsed, 0, nbits);
+    reader->bits.length += nbits;
+
+    // Keep an odd hex digit for next time
+    reader->raw_length = reader->format == FORMAT_HEX ? length % 2 : 0;
+    if (reader->raw_length) {
+        reader->raw[0] = reader->raw[length - 1];
+    }
+
+    return 0;
+}
+
+/// Reads up to nbits bits into stream, which needs room for nbits bits. Text formats skip any whitespace.
+/// Sets the length of stream to the number of bits read, which is only less than nbits at the end of the input.
+/// Returns 0 on success, or -1 if the input contained an invalid character
+int bitreader_read(BitReader *reader, BitStream *stream, size_t nbits) {
+    size_t n;
+
+    if (nbits > reader->remaining) {
+        nbits = reader->remaining;
+    }
+
+    while (reader->bits.length < nbits && !reader->eof) {
+        if (bitreader_fill(reader, nbits - reader->bits.length) < 0) {
+            return -1;
+        }
+    }
+
+    n = reader->bits.length < nbits ? reader->bits.length : nbits;
+    bitstream_init(stream, stream->words, n);
+    bitstream_copy_bits(stream, 0, &reader->bits, 0, n);
+
+    // Move any bits left over to the start
+    if (n) {
+        bitstream_copy_bits(&reader->bits, 0, &reader->bits, n, reader->bits.length - n);
+        bitstream_truncate(&reader->bits, reader->bits.length - n);
+    }
+
+    if (reader->remaining != SIZE_MAX) {
+        reader->remaining -= n;
+    }
+
+    return 0;
+}
+
+/// Frees the buffers of a reader (but doesn't close its file)
+void bitreader_free(BitReader *reader) {
+    free(reader->bits.words);
+    free(reader->raw);
+}
+
+/// Starts writing to a file in the given format
+void bitwriter_init(BitWriter *writer, FILE *file, DataFormat format) {
+    memset(writer, 0, sizeof(BitWriter));
+    writer->file = file;
+    writer->format = format;
+}
+
+/// Writes the first nbytes bytes of the writer's bits to its file
+static void bitwriter_write_bytes(BitWriter *writer, size_t nbytes) {
+    BitStream bytes;
+
+    if (writer->format == FORMAT_BIN) {
+        fwrite(writer->bits.bytes, 1, nbytes, writer->file);
+        return;
+    }
+
+    bytes.words = writer->bits.words;
+    bytes.length = nbytes * 8;
+    bitio_reserve_text(&writer->text, &writer->text_capacity, 2 * nbytes + 1);
+    bitstream_write_to_hex(&bytes, writer->text);
+    fwrite(writer->text, 1, 2 * nbytes, writer->file);
+}
+
+/// Writes all the bits of stream after the bits already written
+void bitwriter_write(BitWriter *writer, const BitStream *stream) {
+    size_t nbytes, left;
+    uint64_t last;
+
+    // Text is one character per bit, so doesn't need to line up with anything
+    if (writer->format == FORMAT_ASCII) {
+        bitio_reserve_text(&writer->text, &writer->text_capacity, stream->length + 1);
+        bitstream_write_to_string(stream, writer->text);
+        fwrite(writer->text, 1, stream->length, writer->file);
+        return;
+    }
+
+    // Bytes can only be written once they're whole, so the last few bits wait for the next chunk
+    bitio_reserve(&writer->bits, &writer->bits_capacity, writer->bits.length + stream->length);
+    bitstream_copy_bits(&writer->bits, writer->bits.length, stream, 0, stream->length);
+    writer->bits.length += stream->length;
+
+    nbytes = writer->bits.length / 8;
+    left = writer->bits.length % 8;
+    bitwriter_write_bytes(writer, nbytes);
+
+    last = left ? bitstream_read_bits(&writer->bits, nbytes * 8, left) : 0;
+    writer->bits.words[0] = last;
+    writer->bits.length = left;
+}
+
+/// Writes out anything left over (bin and hex pad the last byte with 0s, and text ends with a new line), and frees
+/// the buffers of a writer (but doesn't close its file)
+void bitwriter_finish(BitWriter *writer) {
+    if (writer->bits.length) {
+        bitwriter_write_bytes(writer, 1);
+    }
+    if (writer->format != FORMAT_BIN) {
+        fputc('\n', writer->file);
+    }
+
+    free(writer->bits.words);
+    free(writer->text);
+}
+
+/// Writes random bits in random sized chunks with each format, and checks they read back the same in other random
+/// sized chunks
+static void bitio_test_round_trip(DataFormat format) {
+    BitStream *input, *output, chunk;
+    BitWriter writer;
+    BitReader reader;
+    FILE *file;
+    size_t length, offset, n, i;
+    int result;
+
+    for (length = 0; length <= 5000; length += 997) {
+        input = bitstream_create(length);
+        for (i = 0; i < length; i++) {
+            bitstream_set(input, i, rand() & 1);
+        }
+
+        file = tmpfile();
+        bitwriter_init(&writer, file, format);
+        for (offset = 0; offset < length; offset += n) {
+            n = rand() % 300;
+            if (n > length - offset) {
+                n = length - offset;
+            }
+            chunk.words = (uint64_t*)malloc((BITSTREAM_WORDS(n) + 1) * sizeof(uint64_t));
+            bitstream_init(&chunk, chunk.words, n);
+            bitstream_copy_bits(&chunk, 0, input, offset, n);
+            bitwriter_write(&writer, &chunk);
+            free(chunk.words);
+        }
+        bitwriter_finish(&writer);
+
+        // Text formats should also cope with the data being split over lines
+        if (format != FORMAT_BIN) {
+            fputs("\n\n", file);
+        }
+        rewind(file);
+
+        // Binary and hex are padded out to whole bytes, so the reader is limited to the real length
+        output = bitstream_create(length + 300);
+        bitreader_init(&reader, file, format, format == FORMAT_ASCII ? SIZE_MAX : length);
+        chunk.words = (uint64_t*)malloc((BITSTREAM_WORDS(300) + 1) * sizeof(uint64_t));
+        for (offset = 0; ; offset += chunk.length) {
+            result = bitreader_read(&reader, &chunk, rand() % 299 + 1);
+            assert(result == 0);
+            if (!chunk.length) {
+                break;
+            }
+            bitstream_copy_bits(output, offset, &chunk, 0, chunk.length);
+        }
+        assert(offset == length);
+        output->length = length;
+        assert(!bitstream_lt(output, input) && !bitstream_lt(input, output));
+
+        free(chunk.words);
+        bitreader_free(&reader);
+        fclose(file);
+        bitstream_destroy(output);
+        bitstream_destroy(input);
+    }
+}
+
+/// Tests all bitio functions
+void bitio_test() {
+    BitStream stream;
+    BitReader reader;
+    uint64_t words[2];
+    FILE *file;
+    int result;
+
+    printf("  => Testing bitio functions\n");
+
+    bitio_test_round_trip(FORMAT_ASCII);
+    bitio_test_round_trip(FORMAT_BIN);
+    bitio_test_round_trip(FORMAT_HEX);
+
+    // Invalid characters, and a hex digit without a pair, should be errors
+    stream.words = words;
+    file = tmpfile();
+    fputs("0120", file);
+    rewind(file);
+    bitreader_init(&reader, file, FORMAT_ASCII, SIZE_MAX);
+    result = bitreader_read(&reader, &stream, 64);
+    assert(result == -1);
+    bitreader_free(&reader);
+    fclose(file);
+
+    file = tmpfile();
+    fputs("ab c\n", file);
+    rewind(file);
+    bitreader_init(&reader, file, FORMAT_HEX, SIZE_MAX);
+    result = bitreader_read(&reader, &stream, 64);
+    assert(result == -1);
+    bitreader_free(&reader);
+    fclose(file);
+
+    printf("    => Bitio tests passed!\n");
+}
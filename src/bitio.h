@@ -0,0 +1,64 @@
+#ifndef __BITIO_H__
+#define __BITIO_H__
+
+#include <stdio.h>
+#include <bitstream.h>
+
+/// Ways bits can be written in a file
+typedef enum {
+    FORMAT_ASCII,   // '0' and '1' characters
+    FORMAT_BIN,     // Raw bytes, with the first bit in the lowest bit of the first byte (the same as a bitstream)
+    FORMAT_HEX,     // The raw bytes as pairs of hex digits
+} DataFormat;
+
+/// Reads bits from a file a chunk at a time, in any format, so files of any size can be processed in constant memory
+typedef struct {
+    FILE *file;
+    DataFormat format;
+    size_t remaining;       // Bits left before the reader stops (SIZE_MAX to read to the end of the file)
+    BitStream bits;         // Bits that have been read from the file but not returned yet
+    size_t bits_capacity;   // Words allocated for bits
+    char *raw;              // Data read from the file, before it's turned into bits
+    size_t raw_capacity;
+    size_t raw_length;      // Bytes at the start of raw left over from the last read (an odd hex digit)
+    int eof;
+} BitReader;
+
+/// Writes bits to a file a chunk at a time, in any format. Chunks don't have to be whole bytes
+typedef struct {
+    FILE *file;
+    DataFormat format;
+    BitStream bits;         // Bits that haven't made up a whole byte yet, followed by the chunk being written
+    size_t bits_capacity;
+    char *text;             // The chunk being written, as text
+    size_t text_capacity;
+} BitWriter;
+
+/// Parses the name of a data format (ascii, bin or hex). Returns 0 on success, or -1 if it isn't a known format
+int bitio_parse_format(const char *name, DataFormat *format);
+
+/// Starts reading up to limit bits (SIZE_MAX for no limit) from a file in the given format
+void bitreader_init(BitReader *reader, FILE *file, DataFormat format, size_t limit);
+
+/// Reads up to nbits bits into stream, which needs room for nbits bits. Text formats skip any whitespace.
+/// Sets the length of stream to the number of bits read, which is only less than nbits at the end of the input.
+/// Returns 0 on success, or -1 if the input contained an invalid character
+int bitreader_read(BitReader *reader, BitStream *stream, size_t nbits);
+
+/// Frees the buffers of a reader (but doesn't close its file)
+void bitreader_free(BitReader *reader);
+
+/// Starts writing to a file in the given format
+void bitwriter_init(BitWriter *writer, FILE *file, DataFormat format);
+
+/// Writes all the bits of stream after the bits already written
+void bitwriter_write(BitWriter *writer, const BitStream *stream);
+
+/// Writes out anything left over (bin and hex pad the last byte with 0s, and text ends with a new line), and frees
+/// the buffers of a writer (but doesn't close its file)
+void bitwriter_finish(BitWriter *writer);
+
+/// Tests all bitio functions
+void bitio_test();
+
+#endif // __BITIO_H__
@@ -1,126 +1,205 @@
 #include <bitstream.h>
-#include <math.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
 
+// On x86-64 strings are converted with SSE2 (always available), or AVX2 when the cpu supports it
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BITSTREAM_HAVE_SIMD
+#include <immintrin.h>
+#endif
+
+/// Clears any bits past the end of the stream in its last word
+static inline void bitstream_clear_tail(BitStream *stream) {
+    if (stream->length % BITSTREAM_WORD_BITS) {
+        stream->words[stream->length / BITSTREAM_WORD_BITS] &= ((uint64_t)1 << (stream->length % BITSTREAM_WORD_BITS)) - 1;
+    }
+}
+
 /// Creates a new bitstream filled with 0
 BitStream *bitstream_create(size_t len) {
     BitStream *stream;
-    size_t nbytes;
-
-    stream = (BitStream*)malloc(sizeof(BitStream));
 
+    // The words go straight after the header, so they come from the same allocation. Always allocate at least one
+    // word, so even an empty stream has somewhere to point
+    stream = (BitStream*)calloc(1, sizeof(BitStream) + (BITSTREAM_WORDS(len) + 1) * sizeof(uint64_t));
     stream->length = len;
-    nbytes = (int)ceil(stream->length/8.0);
-    stream->bytes = (unsigned char*)malloc(nbytes);
-    memset(stream->bytes, 0, nbytes);
+    stream->words = (uint64_t*)(stream + 1);
+
+    return stream;
+}
+
+/// Creates a new bitstream filled with 0 in an arena, with its words in the same allocation as the header
+BitStream *bitstream_create_in(Arena *arena, size_t len) {
+    BitStream *stream;
+
+    stream = (BitStream*)arena_alloc(arena, sizeof(BitStream) + (BITSTREAM_WORDS(len) + 1) * sizeof(uint64_t));
+    bitstream_init(stream, (uint64_t*)(stream + 1), len);
+    stream->words[BITSTREAM_WORDS(len)] = 0;
 
     return stream;
 }
 
+/// Sets up a bitstream of len bits, filled with 0, in caller owned storage of at least BITSTREAM_WORDS(len) words
+void bitstream_init(BitStream *stream, uint64_t *words, size_t len) {
+    stream->length = len;
+    stream->words = words;
+    memset(words, 0, BITSTREAM_WORDS(len) * sizeof(uint64_t));
+}
+
 /// Creates a new bitstream as a copy of the given bitstream
 BitStream *bitstream_copy(const BitStream *stream, size_t length) {
     BitStream *new_stream;
-    size_t nbytes, stream_bytes;
+    size_t nwords, stream_words;
 
-    new_stream = (BitStream*)malloc(sizeof(BitStream));
+    new_stream = bitstream_create(length);
 
-    new_stream->length = length;
-    nbytes = (int)ceil(new_stream->length/8.0);
-    stream_bytes = (int)ceil(stream->length/8.0);
-    new_stream->bytes = (unsigned char*)malloc(nbytes);
-    memcpy(new_stream->bytes, stream->bytes, (int)fmin(nbytes, stream_bytes));
+    nwords = BITSTREAM_WORDS(length);
+    stream_words = BITSTREAM_WORDS(stream->length);
+    memcpy(new_stream->words, stream->words, (nwords < stream_words ? nwords : stream_words) * sizeof(uint64_t));
+
+    // If the copy is shorter than the original, the end of the last word needs to be cleared
+    bitstream_clear_tail(new_stream);
 
     return new_stream;
 }
 
 BitStream *bitstream_concat(const BitStream *lhs, const BitStream *rhs) {
     BitStream *new_stream;
-    size_t nbytes, stream_bytes, i;
 
-    new_stream = (BitStream*)malloc(sizeof(BitStream));
+    new_stream = bitstream_create(lhs->length + rhs->length);
+
+    // lhs starts on a word boundary so can be copied directly, rhs gets shifted into place after it
+    memcpy(new_stream->words, lhs->words, BITSTREAM_WORDS(lhs->length) * sizeof(uint64_t));
+    bitstream_copy_bits(new_stream, lhs->length, rhs, 0, rhs->length);
 
-    new_stream->length = lhs->length + rhs->length;
-    nbytes = (int)ceil(new_stream->length/8.0);
-    new_stream->bytes = (unsigned char*)malloc(nbytes);
+    return new_stream;
+}
 
-    stream_bytes = (int)ceil(lhs->length/8.0);
-    memcpy(new_stream->bytes, lhs->bytes, stream_bytes);
+/// Creates a new bitstream from length bits of the given stream, starting at offset
+BitStream *bitstream_extract(const BitStream *stream, size_t offset, size_t length) {
+    BitStream *new_stream;
 
-    for (i = lhs->length; i < new_stream->length; i++) {
-        bitstream_set(new_stream, i, bitstream_get(rhs, i - lhs->length));
-    }
+    new_stream = bitstream_create(length);
+    bitstream_copy_bits(new_stream, 0, stream, offset, length);
 
     return new_stream;
 }
 
-void bitstream_destroy(BitStream *stream) {
-    free(stream->bytes);
-    free(stream);
+/// Overwrites the bits of dst starting at offset with the bits of src
+void bitstream_insert(BitStream *dst, size_t offset, const BitStream *src) {
+    bitstream_copy_bits(dst, offset, src, 0, src->length);
+}
+
+/// Reads the 64 bits of the stream starting at the given bit, which doesn't have to be on a word boundary
+static inline uint64_t bitstream_read_word(const BitStream *stream, size_t bit) {
+    size_t word, shift;
+    uint64_t value;
+
+    word = bit / BITSTREAM_WORD_BITS;
+    shift = bit % BITSTREAM_WORD_BITS;
+
+    // Funnel shift the two words the bits are split between (bits past the end of the stream read as 0)
+    value = stream->words[word] >> shift;
+    if (shift && word + 1 < BITSTREAM_WORDS(stream->length)) {
+        value |= stream->words[word + 1] << (BITSTREAM_WORD_BITS - shift);
+    }
+
+    return value;
+}
+
+/// Reads nbits (up to 64) bits of the stream starting at offset, as a word with the first bit in bit 0
+uint64_t bitstream_read_bits(const BitStream *stream, size_t offset, size_t nbits) {
+    uint64_t value;
+
+    value = bitstream_read_word(stream, offset);
+    if (nbits < BITSTREAM_WORD_BITS) {
+        value &= ((uint64_t)1 << nbits) - 1;
+    }
+
+    return value;
 }
 
-unsigned char inline bitstream_get(const BitStream *stream, size_t bit) {
-    return (stream->bytes[bit/8] >> (bit % 8)) & 1;
+/// Writes the low nbits (up to 64) bits of value into the stream starting at offset
+void bitstream_write_bits(BitStream *stream, size_t offset, uint64_t value, size_t nbits) {
+    BitStream src;
+
+    // Wrap the value as a one word stream so it can be copied in like any other
+    src.words = &value;
+    src.length = nbits;
+    bitstream_copy_bits(stream, offset, &src, 0, nbits);
 }
 
-void inline bitstream_set(BitStream *stream, size_t bit, unsigned char value) {
-    if (value) {
-        stream->bytes[bit/8] |= 1 << (bit % 8);
-    } else {
-        stream->bytes[bit/8] &= ~(1 << (bit % 8));
+/// Copies nbits bits from src (starting at src_offset) into dst (starting at dst_offset).
+/// If src and dst are the same stream, dst_offset must not be after src_offset.
+void bitstream_copy_bits(BitStream *dst, size_t dst_offset, const BitStream *src, size_t src_offset, size_t nbits) {
+    size_t word, shift, n;
+    uint64_t mask;
+
+    // Write dst a word at a time. Only the first word can start part way through, after that every word is whole
+    while (nbits) {
+        word = dst_offset / BITSTREAM_WORD_BITS;
+        shift = dst_offset % BITSTREAM_WORD_BITS;
+        n = BITSTREAM_WORD_BITS - shift;
+        if (n > nbits) {
+            n = nbits;
+        }
+
+        mask = n == BITSTREAM_WORD_BITS ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1);
+        dst->words[word] = (dst->words[word] & ~(mask << shift)) | ((bitstream_read_word(src, src_offset) & mask) << shift);
+
+        dst_offset += n;
+        src_offset += n;
+        nbits -= n;
     }
 }
 
-void inline bitstream_toggle(BitStream *stream, size_t bit) {
-    stream->bytes[bit/8] ^= 1 << (bit % 8);
+/// Shortens the stream to length bits, clearing the bits past the new end
+void bitstream_truncate(BitStream *stream, size_t length) {
+    if (length < stream->length) {
+        stream->length = length;
+        bitstream_clear_tail(stream);
+    }
 }
 
-void bitstream_sum(BitStream *stream, size_t bit, unsigned char value) {
-    stream->bytes[bit/8] ^= value << (bit % 8);
+void bitstream_destroy(BitStream *stream) {
+    free(stream);
 }
 
 /// Calculates if the stream lhs represents a smaller binary number than rhs
 int bitstream_lt(const BitStream *lhs, const BitStream *rhs) {
-    size_t lhs_bytes, rhs_bytes, i;
+    size_t lhs_words, rhs_words, i;
 
-    // Calculate the bytes in the streams
-    lhs_bytes = (size_t)ceil(lhs->length/8.0);
-    rhs_bytes = (size_t)ceil(rhs->length/8.0);
+    // Calculate the words in the streams
+    lhs_words = BITSTREAM_WORDS(lhs->length);
+    rhs_words = BITSTREAM_WORDS(rhs->length);
 
-    // let i be the maximum byte index of lhs or rhs
-    i = (size_t)fmax(lhs_bytes, rhs_bytes) - 1;
+    // let i be one past the maximum word index of lhs or rhs
+    i = lhs_words > rhs_words ? lhs_words : rhs_words;
 
-    // Loop through any extra bytes in rhs
-    while (i >= lhs_bytes) {
-        if (rhs->bytes[i]) {
-            // If any extra bytes from rhs are not 0, it is larger than lhs
+    // Loop through any extra words in rhs
+    for (; i > lhs_words; i--) {
+        if (rhs->words[i - 1]) {
+            // If any extra words from rhs are not 0, it is larger than lhs
             return 1;
         }
-        i -= 1;
     }
 
-    // Loop through any extra bytes in lhs
-    while (i >= rhs_bytes) {
-        if (lhs->bytes[i]) {
-            // If any extra bytes from lhs are not 0, it is larger than rhs
+    // Loop through any extra words in lhs
+    for (; i > rhs_words; i--) {
+        if (lhs->words[i - 1]) {
+            // If any extra words from lhs are not 0, it is larger than rhs
             return 0;
         }
-        i -= 1;
     }
 
-    // Loop through bytes in both lhs and rhs
-    while (i >= 0) {
-        if (lhs->bytes[i] < rhs->bytes[i]) {
-            // If any byte of lhs is less than that byte in rhs, lhs is less than rhs (they must be equal up until this point)
-            return 1;
-        } else if (lhs->bytes[i] > rhs->bytes[i]) {
-            // If any byte of lhs is greater than that byte in rhs, lhs is greater than rhs (they must be equal up until this point)
-            return 0;
+    // Loop through words in both lhs and rhs
+    for (; i > 0; i--) {
+        if (lhs->words[i - 1] != rhs->words[i - 1]) {
+            // The first word that differs decides which is larger (they must be equal up until this point)
+            return lhs->words[i - 1] < rhs->words[i - 1];
         }
-
-        // Otherwise the bytes are equal, so continue
-        i -= 1;
     }
 
     // The streams are equal
@@ -128,64 +207,269 @@ int bitstream_lt(const BitStream *lhs, const BitStream *rhs) {
 }
 
 void bitstream_sll(BitStream *stream) {
-    size_t nbytes, i;
-    int carry, tmp;
+    size_t nwords, i;
+    uint64_t carry, tmp;
 
-    nbytes = (size_t)ceil(stream->length/8.0);
+    nwords = BITSTREAM_WORDS(stream->length);
 
     carry = 0;
-    for (i = 0; i < nbytes; i++) {
-        tmp = bitstream_get(stream, (i*8) + 7);
-        stream->bytes[i] <<= 1;
-        bitstream_set(stream, i*8, carry);
+    for (i = 0; i < nwords; i++) {
+        tmp = stream->words[i] >> (BITSTREAM_WORD_BITS - 1);
+        stream->words[i] = (stream->words[i] << 1) | carry;
         carry = tmp;
     }
 
-    // If the last byte is not a full byte, we need to reset the overflow bit to 0 (for future calculations)
-    if (stream->length % 8) {
-        bitstream_set(stream, stream->length, 0);
+    // If the last word is not a full word, we need to reset the overflow bit to 0 (for future calculations)
+    bitstream_clear_tail(stream);
+}
+
+/// Shifts the stream by k bits, towards the end for positive k (like bitstream_sll), or towards the start for
+/// negative k (like bitstream_srl). Bits shifted past either end are dropped, and 0s are shifted in.
+void bitstream_shift(BitStream *stream, ptrdiff_t k) {
+    size_t nwords, words, bits, i;
+    uint64_t low;
+
+    nwords = BITSTREAM_WORDS(stream->length);
+
+    // Split the distance into whole words and the bits left over
+    words = (k < 0 ? -(size_t)k : (size_t)k) / BITSTREAM_WORD_BITS;
+    bits = (k < 0 ? -(size_t)k : (size_t)k) % BITSTREAM_WORD_BITS;
+
+    if (words >= nwords) {
+        memset(stream->words, 0, nwords * sizeof(uint64_t));
+        return;
+    }
+
+    if (k > 0) {
+        // Work down from the end, so each word is read before it's overwritten
+        for (i = nwords; i-- > words;) {
+            low = i > words && bits ? stream->words[i - words - 1] >> (BITSTREAM_WORD_BITS - bits) : 0;
+            stream->words[i] = (stream->words[i - words] << bits) | low;
+        }
+        memset(stream->words, 0, words * sizeof(uint64_t));
+        bitstream_clear_tail(stream);
+    } else if (k < 0) {
+        // Work up from the start, so each word is read before it's overwritten
+        for (i = 0; i + words < nwords; i++) {
+            low = i + words + 1 < nwords && bits ? stream->words[i + words + 1] << (BITSTREAM_WORD_BITS - bits) : 0;
+            stream->words[i] = (stream->words[i + words] >> bits) | low;
+        }
+        memset(&stream->words[nwords - words], 0, words * sizeof(uint64_t));
     }
 }
 
 void bitstream_srl(BitStream *stream) {
-    int nbytes, i, carry, tmp;
+    size_t nwords, i;
 
-    nbytes = (size_t)ceil(stream->length/8.0);
+    nwords = BITSTREAM_WORDS(stream->length);
 
-    carry = 0;
-    for (i = nbytes - 1; i >= 0; i--) {
-        tmp = bitstream_get(stream, i*8);
-        stream->bytes[i] >>= 1;
-        bitstream_set(stream, (i*8) + 7, carry);
-        carry = tmp;
+    if (!nwords) {
+        return;
+    }
+
+    // Each word takes the lowest bit of the word after it as its new highest bit
+    for (i = 0; i + 1 < nwords; i++) {
+        stream->words[i] = (stream->words[i] >> 1) | (stream->words[i + 1] << (BITSTREAM_WORD_BITS - 1));
     }
+    stream->words[nwords - 1] >>= 1;
 }
 
 /// Performs a bitwise xor on lhs, given the rhs argument
 void bitstream_xor(BitStream *lhs, const BitStream *rhs) {
-    int nbytes, i;
+    size_t nwords, i;
 
-    nbytes = (size_t)fmin(ceil(lhs->length/8.0), ceil(rhs->length/8.0));
+    nwords = BITSTREAM_WORDS(lhs->length < rhs->length ? lhs->length : rhs->length);
 
-    for (i = 0; i < nbytes; i++) {
-        lhs->bytes[i] ^= rhs->bytes[i];
+    for (i = 0; i < nwords; i++) {
+        lhs->words[i] ^= rhs->words[i];
     }
+
+    // rhs may have had bits past the end of lhs in the last word
+    bitstream_clear_tail(lhs);
 }
 
-void bitstream_read_from_string(BitStream *stream, const char *str) {
-    size_t i, bits_to_read;
+#ifdef BITSTREAM_HAVE_SIMD
+static pthread_once_t bitstream_avx2_once = PTHREAD_ONCE_INIT;
+static int bitstream_avx2_supported = 0;
 
-    bits_to_read = (int)fmin(stream->length, strlen(str));
+/// Detects whether the cpu supports AVX2 (run through pthread_once, since a stream pipeline's reader and writer can
+/// both reach it at the same time)
+static void bitstream_detect_avx2() {
+    __builtin_cpu_init();
+    bitstream_avx2_supported = __builtin_cpu_supports("avx2");
+}
 
-    for (i = 0; i < bits_to_read; i++) {
-        bitstream_set(stream, i, str[i] == '1');
+/// Checks (once) whether the cpu running the program supports AVX2
+static int bitstream_cpu_has_avx2() {
+    pthread_once(&bitstream_avx2_once, bitstream_detect_avx2);
+    return bitstream_avx2_supported;
+}
+
+/// Packs nchars (a multiple of 16) '0'/'1' characters into bytes, 16 at a time. Returns -1 on any other character.
+static int bitstream_parse_sse2(unsigned char *bytes, const char *str, size_t nchars) {
+    __m128i chars, ones, zeros;
+    uint16_t bits;
+    size_t i;
+
+    zeros = _mm_set1_epi8('0');
+    ones = _mm_set1_epi8('1');
+
+    for (i = 0; i < nchars; i += 16) {
+        chars = _mm_loadu_si128((const __m128i*)&str[i]);
+
+        // Every character has to be either a '0' or a '1'
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, zeros), _mm_cmpeq_epi8(chars, ones))) != 0xffff) {
+            return -1;
+        }
+
+        // The top bit of each byte of the comparison lands in character order, which is also the bit order
+        bits = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, ones));
+        memcpy(&bytes[i / 8], &bits, sizeof(bits));
+    }
+
+    return 0;
+}
+
+/// Packs nchars (a multiple of 32) '0'/'1' characters into bytes, 32 at a time. Returns -1 on any other character.
+__attribute__((target("avx2")))
+static int bitstream_parse_avx2(unsigned char *bytes, const char *str, size_t nchars) {
+    __m256i chars, ones, zeros;
+    uint32_t bits;
+    size_t i;
+
+    zeros = _mm256_set1_epi8('0');
+    ones = _mm256_set1_epi8('1');
+
+    for (i = 0; i < nchars; i += 32) {
+        chars = _mm256_loadu_si256((const __m256i*)&str[i]);
+
+        // Every character has to be either a '0' or a '1'
+        if ((uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chars, zeros),
+                                                           _mm256_cmpeq_epi8(chars, ones))) != 0xffffffff) {
+            return -1;
+        }
+
+        bits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, ones));
+        memcpy(&bytes[i / 8], &bits, sizeof(bits));
+    }
+
+    return 0;
+}
+
+/// Unpacks nchars (a multiple of 16) bits from bytes into '0'/'1' characters, 16 at a time
+static void bitstream_format_sse2(const unsigned char *bytes, char *str, size_t nchars) {
+    __m128i chars, mask, zeros;
+    uint16_t bits;
+    size_t i;
+
+    // Each character checks a different bit of the byte it came from
+    mask = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    zeros = _mm_set1_epi8('0');
+
+    for (i = 0; i < nchars; i += 16) {
+        memcpy(&bits, &bytes[i / 8], sizeof(bits));
+
+        // Spread the first byte over the low 8 characters and the second over the high 8
+        chars = _mm_cvtsi32_si128(bits);
+        chars = _mm_unpacklo_epi8(chars, chars);
+        chars = _mm_unpacklo_epi16(chars, chars);
+        chars = _mm_unpacklo_epi32(chars, chars);
+
+        // Set bits compare to -1, so subtracting from '0' gives '1'
+        chars = _mm_cmpeq_epi8(_mm_and_si128(chars, mask), mask);
+        _mm_storeu_si128((__m128i*)&str[i], _mm_sub_epi8(zeros, chars));
     }
 }
 
-void bitstream_write_to_string(BitStream *stream, char *str) {
+/// Unpacks nchars (a multiple of 32) bits from bytes into '0'/'1' characters, 32 at a time
+__attribute__((target("avx2")))
+static void bitstream_format_avx2(const unsigned char *bytes, char *str, size_t nchars) {
+    __m256i chars, mask, spread, zeros;
+    uint32_t bits;
     size_t i;
 
-    for (i = 0; i < stream->length; i++) {
+    mask = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                              2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    zeros = _mm256_set1_epi8('0');
+
+    for (i = 0; i < nchars; i += 32) {
+        memcpy(&bits, &bytes[i / 8], sizeof(bits));
+
+        // Broadcast the 4 bytes to every lane, then shuffle each byte out to the 8 characters it covers
+        chars = _mm256_shuffle_epi8(_mm256_set1_epi32((int)bits), spread);
+
+        chars = _mm256_cmpeq_epi8(_mm256_and_si256(chars, mask), mask);
+        _mm256_storeu_si256((__m256i*)&str[i], _mm256_sub_epi8(zeros, chars));
+    }
+}
+#endif
+
+/// Reads a string of '0' and '1' characters into the stream, stopping at the end of either.
+/// Returns 0 on success, or -1 if the string contained any other character.
+int bitstream_read_from_string(BitStream *stream, const char *str) {
+    return bitstream_read_from_chars(stream, str, strlen(str));
+}
+
+/// Reads count '0' and '1' characters (which don't need a null terminator) into the stream, stopping at the end of
+/// either. Returns 0 on success, or -1 if there was any other character.
+int bitstream_read_from_chars(BitStream *stream, const char *str, size_t count) {
+    size_t i, n, bits_to_read;
+
+    bits_to_read = count;
+    if (bits_to_read > stream->length) {
+        bits_to_read = stream->length;
+    }
+
+    i = 0;
+
+#ifdef BITSTREAM_HAVE_SIMD
+    // Do as much as possible with the widest kernel, then the rest with narrower ones
+    if (bitstream_cpu_has_avx2()) {
+        n = bits_to_read & ~(size_t)31;
+        if (bitstream_parse_avx2(stream->bytes, str, n) < 0) {
+            return -1;
+        }
+        i = n;
+    }
+
+    n = (bits_to_read - i) & ~(size_t)15;
+    if (bitstream_parse_sse2(&stream->bytes[i / 8], &str[i], n) < 0) {
+        return -1;
+    }
+    i += n;
+#endif
+
+    for (; i < bits_to_read; i++) {
+        if (str[i] != '0' && str[i] != '1') {
+            return -1;
+        }
+        bitstream_set(stream, i, str[i] == '1');
+    }
+
+    return 0;
+}
+
+/// Writes the stream into str as '0' and '1' characters, with a null terminator (str needs length + 1 chars)
+void bitstream_write_to_string(const BitStream *stream, char *str) {
+    size_t i, n;
+
+    i = 0;
+
+#ifdef BITSTREAM_HAVE_SIMD
+    if (bitstream_cpu_has_avx2()) {
+        n = stream->length & ~(size_t)31;
+        bitstream_format_avx2(stream->bytes, str, n);
+        i = n;
+    }
+
+    n = (stream->length - i) & ~(size_t)15;
+    bitstream_format_sse2(&stream->bytes[i / 8], &str[i], n);
+    i += n;
+#endif
+
+    for (; i < stream->length; i++) {
         if (bitstream_get(stream, i)) {
             str[i] = '1';
         } else {
@@ -196,6 +480,283 @@ void bitstream_write_to_string(BitStream *stream, char *str) {
     str[stream->length] = 0;
 }
 
+/// Returns the value of a hex digit, or -1 if the character isn't one
+static inline int bitstream_hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+/// Reads count hex digits into the bytes of the stream, two to a byte, stopping at the end of either.
+/// Returns 0 on success, or -1 if there was any other character (or an odd number of digits).
+int bitstream_read_from_hex(BitStream *stream, const char *str, size_t count) {
+    size_t i, nbytes;
+    int high, low;
+
+    if (count % 2) {
+        return -1;
+    }
+
+    nbytes = BITSTREAM_BYTES(stream->length);
+    if (nbytes > count / 2) {
+        nbytes = count / 2;
+    }
+
+    for (i = 0; i < nbytes; i++) {
+        high = bitstream_hex_digit(str[2 * i]);
+        low = bitstream_hex_digit(str[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return -1;
+        }
+        stream->bytes[i] = (unsigned char)(high << 4 | low);
+    }
+
+    // The last byte can hold bits past the end of the stream, which have to stay 0
+    bitstream_clear_tail(stream);
+
+    return 0;
+}
+
+/// Writes the bytes of the stream into str as pairs of hex digits, with a null terminator (str needs
+/// 2 * BITSTREAM_BYTES(length) + 1 chars)
+void bitstream_write_to_hex(const BitStream *stream, char *str) {
+    static const char digits[] = "0123456789abcdef";
+    size_t i, nbytes;
+
+    nbytes = BITSTREAM_BYTES(stream->length);
+    for (i = 0; i < nbytes; i++) {
+        str[2 * i] = digits[stream->bytes[i] >> 4];
+        str[2 * i + 1] = digits[stream->bytes[i] & 0xf];
+    }
+
+    str[2 * nbytes] = 0;
+}
+
+/// Creates a random string of '0' and '1' characters
+static char* bitstream_test_random_string(size_t length) {
+    char *str;
+    size_t i;
+
+    str = (char*)malloc(length + 1);
+    for (i = 0; i < length; i++) {
+        str[i] = '0' + (rand() & 1);
+    }
+    str[length] = 0;
+
+    return str;
+}
+
+/// Checks the word at a time functions on streams that cross word boundaries, against the same operations done
+/// on strings one character at a time
+static void bitstream_test_words() {
+    char *a, *b, *expected, *output;
+    BitStream *lhs, *rhs, *copy;
+    size_t lhs_length, rhs_length, i;
+
+    srand(4220);
+
+    for (lhs_length = 1; lhs_length <= 200; lhs_length += 7) {
+        rhs_length = 1 + rand() % 200;
+        a = bitstream_test_random_string(lhs_length);
+        b = bitstream_test_random_string(rhs_length);
+        expected = (char*)malloc(lhs_length + rhs_length + 1);
+        output = (char*)malloc(lhs_length + rhs_length + 1);
+
+        lhs = bitstream_create(lhs_length);
+        bitstream_read_from_string(lhs, a);
+        rhs = bitstream_create(rhs_length);
+        bitstream_read_from_string(rhs, b);
+
+        // Logical left shift moves every bit to the next index, dropping the last one
+        copy = bitstream_copy(lhs, lhs->length);
+        bitstream_sll(copy);
+        expected[0] = '0';
+        memcpy(&expected[1], a, lhs_length - 1);
+        expected[lhs_length] = 0;
+        bitstream_write_to_string(copy, output);
+        assert(!strcmp(output, expected));
+        bitstream_destroy(copy);
+
+        // Logical right shift moves every bit to the previous index, filling in a 0 at the end
+        copy = bitstream_copy(lhs, lhs->length);
+        bitstream_srl(copy);
+        memcpy(expected, &a[1], lhs_length - 1);
+        expected[lhs_length - 1] = '0';
+        expected[lhs_length] = 0;
+        bitstream_write_to_string(copy, output);
+        assert(!strcmp(output, expected));
+        bitstream_destroy(copy);
+
+        // Xor only changes the bits that both streams have
+        copy = bitstream_copy(lhs, lhs->length);
+        bitstream_xor(copy, rhs);
+        for (i = 0; i < lhs_length; i++) {
+            expected[i] = (i < rhs_length && a[i] != b[i]) || (i >= rhs_length && a[i] == '1') ? '1' : '0';
+        }
+        expected[lhs_length] = 0;
+        bitstream_write_to_string(copy, output);
+        assert(!strcmp(output, expected));
+        bitstream_destroy(copy);
+
+        // Copying to a shorter length truncates, and to a longer length pads with 0s
+        copy = bitstream_copy(rhs, lhs_length);
+        for (i = 0; i < lhs_length; i++) {
+            expected[i] = i < rhs_length ? b[i] : '0';
+        }
+        expected[lhs_length] = 0;
+        bitstream_write_to_string(copy, output);
+        assert(!strcmp(output, expected));
+
+        // Comparison treats the last bit as the most significant
+        assert(!bitstream_lt(lhs, lhs));
+        for (i = lhs_length; i > 0 && expected[i - 1] == a[i - 1]; i--) {}
+        assert(bitstream_lt(copy, lhs) == (i > 0 && expected[i - 1] < a[i - 1]));
+        assert(bitstream_lt(lhs, copy) == (i > 0 && a[i - 1] < expected[i - 1]));
+        bitstream_destroy(copy);
+
+        free(a);
+        free(b);
+        free(expected);
+        free(output);
+        bitstream_destroy(lhs);
+        bitstream_destroy(rhs);
+    }
+}
+
+/// Checks shifting by any distance, and copying bit ranges between arbitrary offsets
+static void bitstream_test_ranges() {
+    char *a, *b, *expected, *output;
+    BitStream *lhs, *rhs, *stream;
+    size_t lhs_length, rhs_length, offset, length, i;
+    ptrdiff_t k;
+
+    for (lhs_length = 1; lhs_length <= 400; lhs_length += 13) {
+        rhs_length = rand() % 300;
+        a = bitstream_test_random_string(lhs_length);
+        b = bitstream_test_random_string(rhs_length);
+        expected = (char*)malloc(lhs_length + rhs_length + 1);
+        output = (char*)malloc(lhs_length + rhs_length + 1);
+
+        lhs = bitstream_create(lhs_length);
+        bitstream_read_from_string(lhs, a);
+        rhs = bitstream_create(rhs_length);
+        bitstream_read_from_string(rhs, b);
+
+        // Shifting by k moves bit i to i + k
+        k = (ptrdiff_t)(rand() % (2 * lhs_length + 2)) - (ptrdiff_t)lhs_length - 1;
+        stream = bitstream_copy(lhs, lhs->length);
+        bitstream_shift(stream, k);
+        for (i = 0; i < lhs_length; i++) {
+            expected[i] = (ptrdiff_t)i - k >= 0 && (ptrdiff_t)i - k < (ptrdiff_t)lhs_length ? a[i - k] : '0';
+        }
+        expected[lhs_length] = 0;
+        bitstream_write_to_string(stream, output);
+        assert(!strcmp(output, expected));
+        bitstream_destroy(stream);
+
+        // Concatenation
+        stream = bitstream_concat(lhs, rhs);
+        strcpy(expected, a);
+        strcat(expected, b);
+        bitstream_write_to_string(stream, output);
+        assert(!strcmp(output, expected));
+
+        // Extracting a range from the middle of the concatenated stream
+        offset = rand() % (stream->length + 1);
+        length = rand() % (stream->length - offset + 1);
+        bitstream_destroy(lhs);
+        lhs = bitstream_extract(stream, offset, length);
+        bitstream_write_to_string(lhs, output);
+        assert(!strncmp(output, &expected[offset], length) && output[length] == 0);
+
+        // Inserting rhs part way through the concatenated stream
+        offset = rand() % (stream->length - rhs_length + 1);
+        bitstream_insert(stream, offset, rhs);
+        memcpy(&expected[offset], b, rhs_length);
+        bitstream_write_to_string(stream, output);
+        assert(!strcmp(output, expected));
+        bitstream_destroy(stream);
+
+        free(a);
+        free(b);
+        free(expected);
+        free(output);
+        bitstream_destroy(lhs);
+        bitstream_destroy(rhs);
+    }
+}
+
+/// Checks converting to and from strings of every length up to a few words, including rejecting invalid characters
+static void bitstream_test_strings() {
+    char *a, *output, *hex;
+    BitStream *stream, *stream2;
+    size_t length, i;
+    int result;
+
+    for (length = 0; length <= 300; length++) {
+        a = bitstream_test_random_string(length);
+        output = (char*)malloc(length + 1);
+
+        stream = bitstream_create(length);
+        result = bitstream_read_from_string(stream, a);
+        assert(result == 0);
+        bitstream_write_to_string(stream, output);
+        assert(!strcmp(output, a));
+
+#ifdef BITSTREAM_HAVE_SIMD
+        // The dispatched path only uses SSE2 for the tail when AVX2 is available, so check it on its own too
+        memset(stream->bytes, 0, length / 8);
+        result = bitstream_parse_sse2(stream->bytes, a, length & ~(size_t)15);
+        assert(result == 0);
+        bitstream_format_sse2(stream->bytes, output, length & ~(size_t)15);
+        assert(!strcmp(output, a));
+#endif
+
+        // Hex goes through the bytes, so should round trip too
+        hex = (char*)malloc(2 * BITSTREAM_BYTES(length) + 1);
+        bitstream_write_to_hex(stream, hex);
+        assert(strlen(hex) == 2 * BITSTREAM_BYTES(length));
+        stream2 = bitstream_create(length);
+        result = bitstream_read_from_hex(stream2, hex, strlen(hex));
+        assert(result == 0);
+        assert(!bitstream_lt(stream, stream2) && !bitstream_lt(stream2, stream));
+        if (length) {
+            hex[rand() % strlen(hex)] = 'g';
+            result = bitstream_read_from_hex(stream2, hex, strlen(hex));
+            assert(result == -1);
+        }
+        bitstream_destroy(stream2);
+        free(hex);
+
+        // Truncating should leave a prefix, with the padding past it cleared
+        stream2 = bitstream_create(length);
+        bitstream_read_from_string(stream2, a);
+        bitstream_truncate(stream2, length / 2);
+        bitstream_write_to_string(stream2, output);
+        assert(!strncmp(output, a, length / 2) && output[length / 2] == 0);
+        assert(length / 2 % 64 == 0 || !(stream2->words[length / 2 / 64] >> (length / 2 % 64)));
+        bitstream_destroy(stream2);
+
+        // Any character other than '0' or '1' should be rejected, wherever it is
+        if (length) {
+            i = rand() % length;
+            a[i] = "2 a\n"[rand() % 4];
+            result = bitstream_read_from_string(stream, a);
+            assert(result == -1);
+        }
+
+        bitstream_destroy(stream);
+        free(a);
+        free(output);
+    }
+}
+
 /// Tests all bitstream functions
 void bitstream_test() {
     printf("  => Testing bitstream functions\n");
@@ -204,7 +765,7 @@ void bitstream_test() {
     BitStream *stream, *stream2, *stream3;
 
     a = "010101010101";
-    b = (char*)malloc(strlen(a) + 1);
+    b = (char*)malloc(2 * strlen(a) + 1);
 
     stream = bitstream_create(strlen(a));
 
@@ -247,6 +808,11 @@ void bitstream_test() {
     bitstream_destroy(stream);
     bitstream_destroy(stream2);
     bitstream_destroy(stream3);
+    free(b);
+
+    bitstream_test_words();
+    bitstream_test_ranges();
+    bitstream_test_strings();
 
     printf("    => Bitstream tests passed!\n");
 }
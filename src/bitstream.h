@@ -1,38 +1,108 @@
 #ifndef __BITSTREAM_H__
 #define __BITSTREAM_H__
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <arena.h>
 
+// The byte view of a bitstream relies on the bytes of each word being stored lowest first
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "BitStream requires a little endian host"
+#endif
+
+/// Number of bits stored in each word of a bitstream
+#define BITSTREAM_WORD_BITS 64
+
+/// Number of words needed to store len bits
+#define BITSTREAM_WORDS(len) (((len) + BITSTREAM_WORD_BITS - 1) / BITSTREAM_WORD_BITS)
+
+/// Number of bytes needed to store len bits
+#define BITSTREAM_BYTES(len) (((len) + 7) / 8)
+
+/// A string of bits, stored 64 to a word. Bit i is bit (i % 64) of words[i / 64], so it's also bit (i % 8) of
+/// bytes[i / 8]. Any bits past the end of the stream in the last word are kept as 0.
 typedef struct {
-    unsigned char *bytes;
+    union {
+        uint64_t *words;
+        unsigned char *bytes;
+    };
     size_t length;
 } BitStream;
 
 /// Creates a new bitstream filled with 0
 BitStream *bitstream_create(size_t len);
+/// Creates a new bitstream filled with 0 in an arena, with its words in the same allocation as the header
+BitStream *bitstream_create_in(Arena *arena, size_t len);
+/// Sets up a bitstream of len bits, filled with 0, in caller owned storage of at least BITSTREAM_WORDS(len) words.
+/// The stream doesn't own the storage, so it must not be passed to bitstream_destroy
+void bitstream_init(BitStream *stream, uint64_t *words, size_t len);
 /// Creates a new bitstream with a given length, and a copy of the given bitstream
 BitStream *bitstream_copy(const BitStream *stream, size_t length);
 /// Creates a new bitstream by concatinating the given streams
 BitStream *bitstream_concat(const BitStream *lhs, const BitStream *rhs);
+/// Creates a new bitstream from length bits of the given stream, starting at offset
+BitStream *bitstream_extract(const BitStream *stream, size_t offset, size_t length);
+/// Overwrites the bits of dst starting at offset with the bits of src
+void bitstream_insert(BitStream *dst, size_t offset, const BitStream *src);
+/// Copies nbits bits from src (starting at src_offset) into dst (starting at dst_offset).
+/// If src and dst are the same stream, dst_offset must not be after src_offset.
+void bitstream_copy_bits(BitStream *dst, size_t dst_offset, const BitStream *src, size_t src_offset, size_t nbits);
+/// Reads nbits (up to 64) bits of the stream starting at offset, as a word with the first bit in bit 0
+uint64_t bitstream_read_bits(const BitStream *stream, size_t offset, size_t nbits);
+/// Writes the low nbits (up to 64) bits of value into the stream starting at offset
+void bitstream_write_bits(BitStream *stream, size_t offset, uint64_t value, size_t nbits);
+/// Shortens the stream to length bits, clearing the bits past the new end
+void bitstream_truncate(BitStream *stream, size_t length);
 /// Frees the memory allocated for a given bitstream
 void bitstream_destroy(BitStream *stream);
 
-unsigned char bitstream_get(const BitStream *stream, size_t bit);
-void bitstream_set(BitStream *stream, size_t bit, unsigned char value);
-void bitstream_toggle(BitStream *stream, size_t bit);
-void bitstream_sum(BitStream *stream, size_t bit, unsigned char value);
+static inline unsigned char bitstream_get(const BitStream *stream, size_t bit) {
+    return (stream->words[bit / BITSTREAM_WORD_BITS] >> (bit % BITSTREAM_WORD_BITS)) & 1;
+}
+
+static inline void bitstream_set(BitStream *stream, size_t bit, unsigned char value) {
+    if (value) {
+        stream->words[bit / BITSTREAM_WORD_BITS] |= (uint64_t)1 << (bit % BITSTREAM_WORD_BITS);
+    } else {
+        stream->words[bit / BITSTREAM_WORD_BITS] &= ~((uint64_t)1 << (bit % BITSTREAM_WORD_BITS));
+    }
+}
+
+static inline void bitstream_toggle(BitStream *stream, size_t bit) {
+    stream->words[bit / BITSTREAM_WORD_BITS] ^= (uint64_t)1 << (bit % BITSTREAM_WORD_BITS);
+}
+
+static inline void bitstream_sum(BitStream *stream, size_t bit, unsigned char value) {
+    stream->words[bit / BITSTREAM_WORD_BITS] ^= (uint64_t)(value & 1) << (bit % BITSTREAM_WORD_BITS);
+}
 
 /// Calculates if the stream lhs represents a smaller binary number than rhs
 int bitstream_lt(const BitStream *lhs, const BitStream *rhs);
 /// Performs a bitwise logical left shift on the stream
 void bitstream_sll(BitStream *stream);
+/// Shifts the stream by k bits, towards the end for positive k (like bitstream_sll), or towards the start for
+/// negative k (like bitstream_srl)
+void bitstream_shift(BitStream *stream, ptrdiff_t k);
 /// Performs a bitwise logical right shift on the stream
 void bitstream_srl(BitStream *stream);
 /// Performs a bitwise xor on lhs, given the rhs argument
 void bitstream_xor(BitStream *lhs, const BitStream *rhs);
 
-void bitstream_read_from_string(BitStream *stream, const char *str);
-void bitstream_write_to_string(BitStream *stream, char *str);
+/// Reads a string of '0' and '1' characters into the stream, stopping at the end of either.
+/// Returns 0 on success, or -1 if the string contained any other character.
+int bitstream_read_from_string(BitStream *stream, const char *str);
+/// Reads count '0' and '1' characters (which don't need a null terminator) into the stream, stopping at the end of
+/// either. Returns 0 on success, or -1 if there was any other character.
+int bitstream_read_from_chars(BitStream *stream, const char *str, size_t count);
+/// Reads count hex digits into the bytes of the stream, two to a byte, stopping at the end of either.
+/// Returns 0 on success, or -1 if there was any other character (or an odd number of digits).
+int bitstream_read_from_hex(BitStream *stream, const char *str, size_t count);
+/// Writes the bytes of the stream into str as pairs of hex digits, with a null terminator (str needs
+/// 2 * BITSTREAM_BYTES(length) + 1 chars)
+void bitstream_write_to_hex(const BitStream *stream, char *str);
+/// Writes the stream into str as '0' and '1' characters, with a null terminator (str needs length + 1 chars)
+void bitstream_write_to_string(const BitStream *stream, char *str);
 
 /// Tests all bitstream functions
 void bitstream_test();
@@ -1,10 +1,879 @@
 #include <assert.h>
 #include <crc.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
+// Inputs of at least this many bytes use the slicing-by-8 and slicing-by-16 kernels
+#define CRC_SLICE8_THRESHOLD 32
+#define CRC_SLICE16_THRESHOLD 256
+
+// The parallel encoder hands out chunks of at least this many bytes, and about this many chunks per thread
+#define CRC_PARALLEL_MIN_CHUNK (1 << 20)
+#define CRC_PARALLEL_CHUNKS_PER_THREAD 4
+
+// On x86 inputs of at least this many bytes use carry-less multiplication, if the cpu supports it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC_HAVE_CLMUL
+#define CRC_CLMUL_THRESHOLD 512
+#include <immintrin.h>
+#endif
+
+/// Shifts a single bit of input into the remainder
+static void crc_shift_bit(const CRCTable *table, uint64_t *remainder, unsigned char bit) {
+    size_t i;
+    uint64_t top;
+
+    // Bit 0 of the remainder is the highest power, so it's the bit that gets divided out
+    top = (remainder[0] ^ bit) & 1;
+
+    // Shift the remainder towards bit 0, carrying between words
+    for (i = 0; i + 1 < table->words; i++) {
+        remainder[i] = (remainder[i] >> 1) | (remainder[i + 1] << 63);
+    }
+    remainder[table->words - 1] >>= 1;
+
+    // If the bit we shifted out was 1, subtract (xor) the generator
+    if (top) {
+        for (i = 0; i < table->words; i++) {
+            remainder[i] ^= table->poly[i];
+        }
+    }
+}
+
+/// Shifts a whole byte of input into the remainder with one table lookup
+static void crc_shift_byte(const CRCTable *table, uint64_t *remainder, unsigned char byte) {
+    size_t i;
+    const uint64_t *entry;
+
+    // The first 8 bits of the remainder (combined with the input) decide what gets subtracted
+    entry = &table->table[((remainder[0] ^ byte) & 0xff) * table->words];
+
+    for (i = 0; i + 1 < table->words; i++) {
+        remainder[i] = ((remainder[i] >> 8) | (remainder[i + 1] << 56)) ^ entry[i];
+    }
+    remainder[i] = (remainder[i] >> 8) ^ entry[i];
+}
+
+/// Loads 8 bytes of input as a word, with the first byte in the low bits (the same order as the remainder)
+static inline uint64_t crc_load64(const unsigned char *bytes) {
+    uint64_t word;
+
+    memcpy(&word, bytes, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+
+    return word;
+}
+
+/// Single word kernel: one table lookup per byte
+static uint64_t crc_kernel_byte(const CRCTable *table, uint64_t r, const unsigned char *bytes, size_t nbytes) {
+    size_t i;
+
+    for (i = 0; i < nbytes; i++) {
+        r = (r >> 8) ^ table->table[(r ^ bytes[i]) & 0xff];
+    }
+
+    return r;
+}
+
+/// Single word kernel: slicing-by-8, eight independent lookups per 8 bytes of input
+static uint64_t crc_kernel_slice8(const CRCTable *table, uint64_t r, const unsigned char *bytes, size_t nbytes) {
+    const uint64_t *t;
+
+    t = table->slices;
+
+    while (nbytes >= 8) {
+        // The first byte needs to be shifted through 7 more times than the last, so it uses the 7th table
+        r ^= crc_load64(bytes);
+        r = t[7 * 256 + (r & 0xff)] ^ t[6 * 256 + ((r >> 8) & 0xff)] ^
+            t[5 * 256 + ((r >> 16) & 0xff)] ^ t[4 * 256 + ((r >> 24) & 0xff)] ^
+            t[3 * 256 + ((r >> 32) & 0xff)] ^ t[2 * 256 + ((r >> 40) & 0xff)] ^
+            t[1 * 256 + ((r >> 48) & 0xff)] ^ t[0 * 256 + (r >> 56)];
+
+        bytes += 8;
+        nbytes -= 8;
+    }
+
+    return crc_kernel_byte(table, r, bytes, nbytes);
+}
+
+/// Single word kernel: slicing-by-16, sixteen independent lookups per 16 bytes of input
+static uint64_t crc_kernel_slice16(const CRCTable *table, uint64_t r, const unsigned char *bytes, size_t nbytes) {
+    const uint64_t *t;
+    uint64_t s;
+
+    t = table->slices;
+
+    while (nbytes >= 16) {
+        // Only the first 8 bytes overlap the remainder, the next 8 are looked up directly
+        r ^= crc_load64(bytes);
+        s = crc_load64(bytes + 8);
+        r = t[15 * 256 + (r & 0xff)] ^ t[14 * 256 + ((r >> 8) & 0xff)] ^
+            t[13 * 256 + ((r >> 16) & 0xff)] ^ t[12 * 256 + ((r >> 24) & 0xff)] ^
+            t[11 * 256 + ((r >> 32) & 0xff)] ^ t[10 * 256 + ((r >> 40) & 0xff)] ^
+            t[9 * 256 + ((r >> 48) & 0xff)] ^ t[8 * 256 + (r >> 56)] ^
+            t[7 * 256 + (s & 0xff)] ^ t[6 * 256 + ((s >> 8) & 0xff)] ^
+            t[5 * 256 + ((s >> 16) & 0xff)] ^ t[4 * 256 + ((s >> 24) & 0xff)] ^
+            t[3 * 256 + ((s >> 32) & 0xff)] ^ t[2 * 256 + ((s >> 40) & 0xff)] ^
+            t[1 * 256 + ((s >> 48) & 0xff)] ^ t[0 * 256 + (s >> 56)];
+
+        bytes += 16;
+        nbytes -= 16;
+    }
+
+    return crc_kernel_byte(table, r, bytes, nbytes);
+}
+
+#ifdef CRC_HAVE_CLMUL
+static pthread_once_t crc_clmul_once = PTHREAD_ONCE_INIT;
+static int crc_clmul_supported = 0;
+
+/// Detects whether the cpu supports carry-less multiplication (run through pthread_once, since the stream
+/// pipeline's workers can all reach it at the same time)
+static void crc_detect_clmul() {
+    __builtin_cpu_init();
+    crc_clmul_supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2");
+}
+
+/// Checks (once) whether the cpu running the program supports carry-less multiplication
+static int crc_cpu_has_clmul() {
+    pthread_once(&crc_clmul_once, crc_detect_clmul);
+    return crc_clmul_supported;
+}
+
+/// Folds a 128 bit block forward by the distance its constants were built for
+__attribute__((target("pclmul,sse2")))
+static inline __m128i crc_clmul_fold(__m128i x, __m128i k) {
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11));
+}
+
+/// Single word kernel: carry-less multiply folding, 64 bytes per step in 4 independent 128 bit lanes.
+///
+/// Each lane is multiplied forward by x^512 modulo the generator and xored with the next 64 bytes. At the end the
+/// lanes are folded down into one block, which (along with any leftover input) goes through the slicing kernel.
+__attribute__((target("pclmul,sse2")))
+static uint64_t crc_kernel_clmul(const CRCTable *table, uint64_t r, const unsigned char *bytes, size_t nbytes) {
+    __m128i x0, x1, x2, x3, k;
+    unsigned char block[16];
+
+    // Need at least two steps worth of input to be worth setting up the lanes
+    if (nbytes < 128) {
+        return crc_kernel_slice16(table, r, bytes, nbytes);
+    }
+
+    // The remainder so far is added to the first 64 bits of input
+    x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)bytes), _mm_cvtsi64_si128((long long)r));
+    x1 = _mm_loadu_si128((const __m128i*)(bytes + 16));
+    x2 = _mm_loadu_si128((const __m128i*)(bytes + 32));
+    x3 = _mm_loadu_si128((const __m128i*)(bytes + 48));
+    bytes += 64;
+    nbytes -= 64;
+
+    k = _mm_loadu_si128((const __m128i*)&table->fold[0]);
+    while (nbytes >= 64) {
+        x0 = _mm_xor_si128(crc_clmul_fold(x0, k), _mm_loadu_si128((const __m128i*)bytes));
+        x1 = _mm_xor_si128(crc_clmul_fold(x1, k), _mm_loadu_si128((const __m128i*)(bytes + 16)));
+        x2 = _mm_xor_si128(crc_clmul_fold(x2, k), _mm_loadu_si128((const __m128i*)(bytes + 32)));
+        x3 = _mm_xor_si128(crc_clmul_fold(x3, k), _mm_loadu_si128((const __m128i*)(bytes + 48)));
+        bytes += 64;
+        nbytes -= 64;
+    }
+
+    // Fold the 4 lanes into one, each lane is 128 bits further from the end than the next
+    x3 = _mm_xor_si128(x3, crc_clmul_fold(x0, _mm_loadu_si128((const __m128i*)&table->fold[2])));
+    x3 = _mm_xor_si128(x3, crc_clmul_fold(x1, _mm_loadu_si128((const __m128i*)&table->fold[4])));
+    x3 = _mm_xor_si128(x3, crc_clmul_fold(x2, _mm_loadu_si128((const __m128i*)&table->fold[6])));
+
+    // Fold in any remaining whole blocks
+    k = _mm_loadu_si128((const __m128i*)&table->fold[6]);
+    while (nbytes >= 16) {
+        x3 = _mm_xor_si128(crc_clmul_fold(x3, k), _mm_loadu_si128((const __m128i*)bytes));
+        bytes += 16;
+        nbytes -= 16;
+    }
+
+    // The folded block has the same remainder as all of the input before it, so finish with the table
+    _mm_storeu_si128((__m128i*)block, x3);
+    r = crc_kernel_slice16(table, 0, block, sizeof(block));
+
+    return crc_kernel_slice16(table, r, bytes, nbytes);
+}
+#endif
+
+/// Runs nbits bits of input (stored the same way as a bitstream) through the remainder
+static void crc_process(const CRCTable *table, uint64_t *remainder, const unsigned char *bytes, size_t nbits) {
+    size_t nbytes, i;
+
+    // With a width of 0 the remainder is always empty
+    if (!table->words) {
+        return;
+    }
+
+    nbytes = nbits / 8;
+
+    if (table->words == 1) {
+        // Most generators fit in a single word, so keep the remainder in a register and pick the widest
+        // kernel that is worth its setup for this much input
+#ifdef CRC_HAVE_CLMUL
+        if (nbytes >= CRC_CLMUL_THRESHOLD && crc_cpu_has_clmul()) {
+            remainder[0] = crc_kernel_clmul(table, remainder[0], bytes, nbytes);
+        } else
+#endif
+        if (nbytes >= CRC_SLICE16_THRESHOLD) {
+            remainder[0] = crc_kernel_slice16(table, remainder[0], bytes, nbytes);
+        } else if (nbytes >= CRC_SLICE8_THRESHOLD) {
+            remainder[0] = crc_kernel_slice8(table, remainder[0], bytes, nbytes);
+        } else {
+            remainder[0] = crc_kernel_byte(table, remainder[0], bytes, nbytes);
+        }
+    } else {
+        for (i = 0; i < nbytes; i++) {
+            crc_shift_byte(table, remainder, bytes[i]);
+        }
+    }
+
+    // Any bits left over that don't make up a full byte are done one at a time
+    for (i = nbytes * 8; i < nbits; i++) {
+        crc_shift_bit(table, remainder, (bytes[i / 8] >> (i % 8)) & 1);
+    }
+}
+
+/// Multiplies a and b modulo the generator (padded to whole words) into out, which may be either of a or b
+static void crc_mulmod(const CRCTable *table, const uint64_t *a, const uint64_t *b, uint64_t *out) {
+    uint64_t *r, word;
+    size_t i, j;
+
+    // Generators that fit in one word keep the product in a register, without an allocation
+    if (table->words == 1) {
+        word = 0;
+        for (i = 0; i < 64; i++) {
+            word = (word >> 1) ^ (word & 1 ? table->poly[0] : 0);
+            if ((b[0] >> i) & 1) {
+                word ^= a[0];
+            }
+        }
+        out[0] = word;
+        return;
+    }
+
+    r = (uint64_t*)calloc(table->words + 1, sizeof(uint64_t));
+
+    // Horner's method over the bits of b, starting from the highest power (bit 0)
+    for (i = 0; i < table->words * 64; i++) {
+        crc_shift_bit(table, r, 0);
+        if ((b[i / 64] >> (i % 64)) & 1) {
+            for (j = 0; j < table->words; j++) {
+                r[j] ^= a[j];
+            }
+        }
+    }
+
+    memcpy(out, r, table->words * sizeof(uint64_t));
+    free(r);
+}
+
+/// Calculates x^n modulo the generator (padded to whole words) into out, with O(log n) multiplications
+static void crc_xpow(const CRCTable *table, size_t n, uint64_t *out) {
+    int bit;
+
+    if (!table->words) {
+        return;
+    }
+
+    // The last bit is the lowest power, so start with x^0 = 1
+    memset(out, 0, table->words * sizeof(uint64_t));
+    out[table->words - 1] = (uint64_t)1 << 63;
+
+    // Square and multiply, going through the bits of n from the highest one that's set
+    for (bit = sizeof(n) * 8 - 1; bit >= 0 && !((n >> bit) & 1); bit--);
+    for (; bit >= 0; bit--) {
+        crc_mulmod(table, out, out, out);
+        if ((n >> bit) & 1) {
+            crc_shift_bit(table, out, 0);
+        }
+    }
+}
+
+/// Allocates a crc table with only the generator filled in (which is all the polynomial arithmetic needs)
+static CRCTable* crc_table_create_poly(const BitStream *generator) {
+    CRCTable *table;
+    uint64_t *poly;
+    size_t i;
+
+    table = (CRCTable*)malloc(sizeof(CRCTable));
+
+    // The leading bit of the generator is always divided out, so the remainder is one bit shorter
+    table->width = generator->length ? generator->length - 1 : 0;
+    table->words = (table->width + 63) / 64;
+
+    // Store the rest of the generator in the same order as the remainder. Any bits past the width are left as 0,
+    // which is equivalent to dividing by the generator multiplied up to a whole number of words
+    poly = (uint64_t*)calloc(table->words + 1, sizeof(uint64_t));
+    for (i = 0; i < table->width; i++) {
+        if (bitstream_get(generator, i + 1)) {
+            poly[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+    }
+    table->poly = poly;
+
+    table->table = NULL;
+    table->slices = NULL;
+    memset(table->fold, 0, sizeof(table->fold));
+
+    return table;
+}
+
+/// Copies the first width bits of a remainder into a new bitstream
+static BitStream* crc_remainder_to_stream(const CRCTable *table, const uint64_t *remainder) {
+    BitStream *stream;
+    size_t i;
+
+    stream = bitstream_create(table->width);
+    for (i = 0; i < table->width; i++) {
+        bitstream_set(stream, i, (remainder[i / 64] >> (i % 64)) & 1);
+    }
+
+    return stream;
+}
+
+/// Copies a bitstream of up to width bits into a remainder, padding it with 0s
+static void crc_remainder_from_stream(const CRCTable *table, const BitStream *stream, uint64_t *remainder) {
+    size_t i;
+
+    memset(remainder, 0, table->words * sizeof(uint64_t));
+    for (i = 0; i < table->width && i < stream->length; i++) {
+        remainder[i / 64] |= (uint64_t)bitstream_get(stream, i) << (i % 64);
+    }
+}
+
+/// Builds the lookup table for the given generator
+CRCTable* crc_table_create(const BitStream *generator) {
+    CRCTable *table;
+    uint64_t *entries, *entry, *slices;
+    size_t i, bit;
+
+    table = crc_table_create_poly(generator);
+
+    // Each entry is the remainder left after shifting the index through 8 times with no input
+    entries = (uint64_t*)calloc(256 * table->words + 1, sizeof(uint64_t));
+    if (table->words) {
+        for (i = 0; i < 256; i++) {
+            entry = &entries[i * table->words];
+            entry[0] = i;
+            for (bit = 0; bit < 8; bit++) {
+                crc_shift_bit(table, entry, 0);
+            }
+        }
+    }
+
+    table->table = entries;
+
+    // Generators that fit in one word also get the tables for the slicing kernels. Table k holds the remainder
+    // of each byte followed by k more bytes of 0s
+    table->slices = NULL;
+    if (table->words == 1) {
+        slices = (uint64_t*)malloc(CRC_SLICES * 256 * sizeof(uint64_t));
+        memcpy(slices, entries, 256 * sizeof(uint64_t));
+        for (i = 256; i < CRC_SLICES * 256; i++) {
+            slices[i] = (slices[i - 256] >> 8) ^ entries[slices[i - 256] & 0xff];
+        }
+        table->slices = slices;
+    }
+
+    // The folding constants are x^(d+63) and x^(d-1) modulo the generator for each fold distance d. The extra
+    // power of x accounts for the product of two 64 bit values only being 127 bits long
+    if (table->words == 1) {
+        for (i = 0; i < 4; i++) {
+            crc_xpow(table, (4 - i) * 128 + 63, &table->fold[2 * i]);
+            crc_xpow(table, (4 - i) * 128 - 1, &table->fold[2 * i + 1]);
+        }
+    }
+
+    return table;
+}
+
+/// Free memory allocated for a crc table
+void crc_table_destroy(CRCTable *table) {
+    free((uint64_t*)table->poly);
+    free((uint64_t*)table->table);
+    free((uint64_t*)table->slices);
+    free(table);
+}
+
 /// Encodes the given bitstream into a new crc frame
 CRCFrame* crc_encode(const BitStream *input, const BitStream *generator) {
+    CRCTable *table;
+    CRCFrame *frame;
+
+    table = crc_table_create(generator);
+    frame = crc_encode_table(input, table);
+    crc_table_destroy(table);
+
+    return frame;
+}
+
+/// Encodes the given bitstream into a new crc frame, using a table built by crc_table_create
+CRCFrame* crc_encode_table(const BitStream *input, const CRCTable *table) {
+    CRCFrame *frame;
+
+    // Allocate memory for a new frame, and work out the remainder straight into the end of it
+    frame = (CRCFrame*)malloc(sizeof(CRCFrame));
+    frame->frame_bits = input->length + table->width;
+    frame->frame_stream = bitstream_create(frame->frame_bits);
+
+    crc_encode_into(input, table, frame->frame_stream);
+
+    return frame;
+}
+
+/// Encodes the given bitstream into a new crc frame allocated from an arena, using a table built by crc_table_create
+CRCFrame* crc_encode_in(Arena *arena, const BitStream *input, const CRCTable *table) {
+    CRCFrame *frame;
+
+    frame = (CRCFrame*)arena_alloc(arena, sizeof(CRCFrame));
+    frame->frame_bits = input->length + table->width;
+    frame->frame_stream = bitstream_create_in(arena, frame->frame_bits);
+
+    crc_encode_into(input, table, frame->frame_stream);
+
+    return frame;
+}
+
+/// Given a message length and the length of the generator (both in bits), returns the number of bits in the crc
+/// frame for that message
+size_t crc_frame_length(size_t message_length, size_t generator_length) {
+    return message_length + generator_length - 1;
+}
+
+/// Encodes input into frame, a caller owned stream with room for crc_frame_length(input->length, generator length)
+/// bits
+void crc_encode_into(const BitStream *input, const CRCTable *table, BitStream *frame) {
+    uint64_t stack_remainder[CRC_STACK_WORDS + 1], *remainder_words;
+    BitStream remainder;
+    size_t input_words;
+
+    // Only remainders too wide to fit on the stack need an allocation
+    remainder_words = stack_remainder;
+    if (table->words > CRC_STACK_WORDS) {
+        remainder_words = (uint64_t*)malloc((table->words + 1) * sizeof(uint64_t));
+    }
+    memset(remainder_words, 0, (table->words + 1) * sizeof(uint64_t));
+
+    // Run the whole input through the remainder, starting from 0
+    crc_process(table, remainder_words, input->bytes, input->length);
+
+    // The frame is the input followed by the first width bits of the remainder
+    input_words = BITSTREAM_WORDS(input->length);
+    frame->length = input->length + table->width;
+    memcpy(frame->words, input->words, input_words * sizeof(uint64_t));
+    memset(frame->words + input_words, 0, (BITSTREAM_WORDS(frame->length) - input_words) * sizeof(uint64_t));
+
+    remainder.words = remainder_words;
+    remainder.length = table->width;
+    bitstream_copy_bits(frame, input->length, &remainder, 0, table->width);
+
+    if (remainder_words != stack_remainder) {
+        free(remainder_words);
+    }
+}
+
+/// Starts a new incremental crc calculation for the given generator
+CRCContext* crc_init(const BitStream *generator) {
+    CRCContext *ctx;
+
+    ctx = crc_init_table(crc_table_create(generator));
+    ctx->owned_table = (CRCTable*)ctx->table;
+
+    return ctx;
+}
+
+/// Starts a new incremental crc calculation with an existing table, which must outlive the context
+CRCContext* crc_init_table(const CRCTable *table) {
+    CRCContext *ctx;
+
+    ctx = (CRCContext*)malloc(sizeof(CRCContext));
+
+    ctx->table = table;
+    ctx->owned_table = NULL;
+    ctx->remainder = (uint64_t*)calloc(table->words + 1, sizeof(uint64_t));
+    ctx->bits = 0;
+
+    return ctx;
+}
+
+/// Feeds the next nbits bits of the message (stored the same way as a bitstream) into the calculation
+void crc_update(CRCContext *ctx, const unsigned char *bytes, size_t nbits) {
+    crc_process(ctx->table, ctx->remainder, bytes, nbits);
+    ctx->bits += nbits;
+}
+
+/// Finishes an incremental crc calculation, returning the remainder and freeing the context
+BitStream* crc_finalize(CRCContext *ctx) {
+    BitStream *remainder;
+
+    // Copy the remainder into a bitstream so it can be appended to the input
+    remainder = crc_remainder_to_stream(ctx->table, ctx->remainder);
+
+    // Clean up
+    if (ctx->owned_table) {
+        crc_table_destroy(ctx->owned_table);
+    }
+    free(ctx->remainder);
+    free(ctx);
+
+    return remainder;
+}
+
+/// Work shared between the threads of crc_encode_parallel
+typedef struct {
+    const CRCTable *table;
+    const BitStream *input;
+    size_t chunk_bytes;         // Size of each chunk (the last chunk also gets any bits past the last whole byte)
+    size_t chunks;              // Number of chunks
+    size_t next_chunk;          // Index of the next chunk to hand out (updated atomically)
+    BitStream **remainders;     // Remainder of each chunk on its own
+} CRCParallelJob;
+
+/// Returns the number of bits in a chunk of a parallel job
+static size_t crc_parallel_chunk_bits(const CRCParallelJob *job, size_t chunk) {
+    if (chunk + 1 == job->chunks) {
+        return job->input->length - chunk * job->chunk_bytes * 8;
+    }
+
+    return job->chunk_bytes * 8;
+}
+
+/// Worker thread for crc_encode_parallel, takes chunks until there are none left
+static void* crc_parallel_worker(void *arg) {
+    CRCParallelJob *job;
+    CRCContext *ctx;
+    size_t chunk;
+
+    job = (CRCParallelJob*)arg;
+
+    while ((chunk = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED)) < job->chunks) {
+        ctx = crc_init_table(job->table);
+        crc_update(ctx, &job->input->bytes[chunk * job->chunk_bytes], crc_parallel_chunk_bits(job, chunk));
+        job->remainders[chunk] = crc_finalize(ctx);
+    }
+
+    return NULL;
+}
+
+/// Encodes the given bitstream into a new crc frame, splitting the work between the given number of threads
+CRCFrame* crc_encode_parallel(const BitStream *input, const CRCTable *table, size_t threads) {
+    CRCFrame *frame;
+
+    frame = (CRCFrame*)malloc(sizeof(CRCFrame));
+    frame->frame_bits = input->length + table->width;
+    frame->frame_stream = bitstream_create(frame->frame_bits);
+
+    crc_encode_parallel_into(input, table, threads, frame->frame_stream);
+
+    return frame;
+}
+
+/// Encodes input into frame (a caller owned stream, like crc_encode_into), splitting the work between the given
+/// number of threads
+void crc_encode_parallel_into(const BitStream *input, const CRCTable *table, size_t threads, BitStream *frame) {
+    CRCParallelJob job;
+    BitStream *remainder, *combined;
+    pthread_t *workers;
+    size_t nbytes, input_words, started, i;
+
+    // Split the input into whole bytes, with enough chunks that the threads stay busy until the end
+    nbytes = input->length / 8;
+    job.chunk_bytes = threads ? nbytes / (threads * CRC_PARALLEL_CHUNKS_PER_THREAD) : 0;
+    if (job.chunk_bytes < CRC_PARALLEL_MIN_CHUNK) {
+        job.chunk_bytes = CRC_PARALLEL_MIN_CHUNK;
+    }
+    job.chunks = nbytes / job.chunk_bytes;
+
+    // If there isn't enough input to split up it's faster to just do it on this thread
+    if (threads < 2 || job.chunks < 2) {
+        crc_encode_into(input, table, frame);
+        return;
+    }
+
+    job.table = table;
+    job.input = input;
+    job.next_chunk = 0;
+    job.remainders = (BitStream**)malloc(job.chunks * sizeof(BitStream*));
+
+    // This thread works on chunks too, so only start threads - 1 more. Chunks are handed out as they're asked for,
+    // so if a thread can't be started this one just ends up taking its share
+    workers = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    for (started = 0; started + 1 < threads; started++) {
+        if (pthread_create(&workers[started], NULL, crc_parallel_worker, &job)) {
+            break;
+        }
+    }
+    crc_parallel_worker(&job);
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    // Merge the chunk remainders in order
+    remainder = job.remainders[0];
+    for (i = 1; i < job.chunks; i++) {
+        combined = crc_combine_table(remainder, job.remainders[i], crc_parallel_chunk_bits(&job, i), table);
+        bitstream_destroy(remainder);
+        bitstream_destroy(job.remainders[i]);
+        remainder = combined;
+    }
+
+    // The frame is the input followed by the remainder
+    input_words = BITSTREAM_WORDS(input->length);
+    frame->length = input->length + table->width;
+    memcpy(frame->words, input->words, input_words * sizeof(uint64_t));
+    memset(frame->words + input_words, 0, (BITSTREAM_WORDS(frame->length) - input_words) * sizeof(uint64_t));
+    bitstream_copy_bits(frame, input->length, remainder, 0, table->width);
+
+    // Clean up
+    bitstream_destroy(remainder);
+    free(job.remainders);
+    free(workers);
+}
+
+/// Given the remainders of two messages A and B, calculates the remainder of A followed by B
+BitStream* crc_combine(const BitStream *crc_a, const BitStream *crc_b, size_t len_b, const BitStream *generator) {
+    CRCTable *table;
+    BitStream *combined;
+
+    table = crc_table_create_poly(generator);
+    combined = crc_combine_table(crc_a, crc_b, len_b, table);
+    crc_table_destroy(table);
+
+    return combined;
+}
+
+/// Given the remainders of two messages A and B, calculates the remainder of A followed by B, using an existing table
+BitStream* crc_combine_table(const BitStream *crc_a, const BitStream *crc_b, size_t len_b, const CRCTable *table) {
+    uint64_t *a, *b, *shift;
+    BitStream *combined;
+    size_t i;
+
+    a = (uint64_t*)calloc(table->words + 1, sizeof(uint64_t));
+    b = (uint64_t*)calloc(table->words + 1, sizeof(uint64_t));
+    shift = (uint64_t*)calloc(table->words + 1, sizeof(uint64_t));
+
+    crc_remainder_from_stream(table, crc_a, a);
+    crc_remainder_from_stream(table, crc_b, b);
+
+    // The crc is linear, so the remainder of A followed by B is the remainder of A shifted up by the length of
+    // B (A * x^len_b mod G), plus the remainder of B
+    crc_xpow(table, len_b, shift);
+    crc_mulmod(table, a, shift, a);
+    for (i = 0; i < table->words; i++) {
+        a[i] ^= b[i];
+    }
+
+    combined = crc_remainder_to_stream(table, a);
+
+    free(a);
+    free(b);
+    free(shift);
+
+    return combined;
+}
+
+/// Updates the remainder of a frame after bits of its message were flipped in place, without going over the rest of
+/// the message. Returns 0 on success, or -1 if a position isn't in the message
+int crc_update_bits(CRCFrame *frame, const CRCTable *table, const size_t *positions, size_t count) {
+    uint64_t *delta, *power;
+    size_t message_bits, padding, i, j, nbits;
+
+    if (frame->frame_bits < table->width) {
+        return -1;
+    }
+    message_bits = frame->frame_bits - table->width;
+    for (i = 0; i < count; i++) {
+        if (positions[i] >= message_bits) {
+            return -1;
+        }
+    }
+
+    delta = (uint64_t*)calloc(table->words + 1, sizeof(uint64_t));
+    power = (uint64_t*)calloc(table->words + 1, sizeof(uint64_t));
+
+    // The crc is linear, so flipping the bit at position i changes the remainder by the remainder of that bit alone:
+    // x^(frame_bits - 1 - i) mod G. The remainder is kept padded out to whole words, which is the same as being
+    // multiplied by x^padding, so that's added to the power
+    padding = table->words * 64 - table->width;
+    for (i = 0; i < count; i++) {
+        crc_xpow(table, frame->frame_bits - 1 - positions[i] + padding, power);
+        for (j = 0; j < table->words; j++) {
+            delta[j] ^= power[j];
+        }
+    }
+
+    for (j = 0; j < table->words; j++) {
+        nbits = table->width - j * 64 < 64 ? table->width - j * 64 : 64;
+        bitstream_write_bits(frame->frame_stream, message_bits + j * 64,
+                             bitstream_read_bits(frame->frame_stream, message_bits + j * 64, nbits) ^ delta[j], nbits);
+    }
+
+    free(delta);
+    free(power);
+
+    return 0;
+}
+
+/// Calculates the syndrome of a received frame into syndrome (table->words + 1 words): the remainder of the message
+/// part, xored with the remainder that was received. Returns -1 if the frame is too short to hold a remainder
+static int crc_frame_syndrome(const CRCFrame *frame, const CRCTable *table, uint64_t *syndrome) {
+    size_t message_bits, i;
+
+    if (frame->frame_bits < table->width) {
+        return -1;
+    }
+    message_bits = frame->frame_bits - table->width;
+
+    memset(syndrome, 0, (table->words + 1) * sizeof(uint64_t));
+    crc_process(table, syndrome, frame->frame_stream->bytes, message_bits);
+
+    // Both are in frame order, so the received remainder can be xored straight in a word at a time
+    for (i = 0; i < table->words; i++) {
+        syndrome[i] ^= bitstream_read_bits(frame->frame_stream, message_bits + i * 64,
+                                           table->width - i * 64 < 64 ? table->width - i * 64 : 64);
+    }
+
+    return 0;
+}
+
+/// Checks a received frame (a message followed by its remainder), returning 1 if its remainder is 0, or 0 if it has
+/// errors
+int crc_verify(const CRCFrame *frame, const BitStream *generator) {
+    CRCTable *table;
+    int valid;
+
+    table = crc_table_create(generator);
+    valid = crc_verify_table(frame, table);
+    crc_table_destroy(table);
+
+    return valid;
+}
+
+/// Checks a received frame, like crc_verify, using a table built by crc_table_create
+int crc_verify_table(const CRCFrame *frame, const CRCTable *table) {
+    uint64_t stack_syndrome[CRC_STACK_WORDS + 1], *syndrome;
+    size_t i;
+    int valid;
+
+    // Like crc_encode_into, only syndromes too wide to fit on the stack need an allocation
+    syndrome = stack_syndrome;
+    if (table->words > CRC_STACK_WORDS) {
+        syndrome = (uint64_t*)malloc((table->words + 1) * sizeof(uint64_t));
+    }
+
+    valid = !crc_frame_syndrome(frame, table, syndrome);
+    for (i = 0; valid && i < table->words; i++) {
+        valid = !syndrome[i];
+    }
+
+    if (syndrome != stack_syndrome) {
+        free(syndrome);
+    }
+
+    return valid;
+}
+
+/// Returns the slot a syndrome hashes to (Fibonacci hashing, which spreads out the low bits of the key)
+static inline size_t crc_syndrome_slot(const CRCSyndromeTable *syndromes, uint64_t syndrome) {
+    return (size_t)((syndrome * 0x9e3779b97f4a7c15ull) >> syndromes->shift);
+}
+
+/// Builds the syndrome lookup for single bit errors in frames of up to max_bits bits
+CRCSyndromeTable* crc_syndrome_table_create(const CRCTable *table, size_t max_bits) {
+    CRCSyndromeTable *syndromes;
+    uint64_t syndrome;
+    size_t slots, slot, k;
+    unsigned int bits;
+
+    if (table->words != 1) {
+        return NULL;
+    }
+
+    syndromes = (CRCSyndromeTable*)malloc(sizeof(CRCSyndromeTable));
+    syndromes->table = table;
+
+    // Keep the table at most half full, so probes stay short
+    for (bits = 1; ((size_t)1 << bits) < 2 * max_bits; bits++);
+    slots = (size_t)1 << bits;
+    syndromes->shift = 64 - bits;
+    syndromes->syndromes = (uint64_t*)calloc(slots, sizeof(uint64_t));
+    syndromes->powers = (size_t*)malloc(slots * sizeof(size_t));
+
+    // Step through x^k mod G, starting from x^0 = 1 (the last bit of the remainder). Once a syndrome comes round
+    // again (or is 0, when the generator is a multiple of x) errors further from the end can't be told apart
+    syndrome = (uint64_t)1 << (table->width - 1);
+    for (k = 0; k < max_bits && syndrome; k++) {
+        for (slot = crc_syndrome_slot(syndromes, syndrome);
+             syndromes->syndromes[slot] && syndromes->syndromes[slot] != syndrome; slot = (slot + 1) & (slots - 1));
+        if (syndromes->syndromes[slot]) {
+            break;
+        }
+        syndromes->syndromes[slot] = syndrome;
+        syndromes->powers[slot] = k;
+
+        crc_shift_bit(table, &syndrome, 0);
+    }
+    syndromes->max_bits = k;
+
+    return syndromes;
+}
+
+/// Free memory allocated for a syndrome table
+void crc_syndrome_table_destroy(CRCSyndromeTable *syndromes) {
+    free(syndromes->syndromes);
+    free(syndromes->powers);
+    free(syndromes);
+}
+
+/// Returns the position of the bit in error in a received frame, CRC_FRAME_VALID if it has no errors, or
+/// CRC_FRAME_UNCORRECTABLE if the error isn't a single bit
+size_t crc_locate_error(const CRCFrame *frame, const CRCSyndromeTable *syndromes) {
+    uint64_t syndrome[2];
+    size_t slot, mask;
+
+    if (crc_frame_syndrome(frame, syndromes->table, syndrome)) {
+        return CRC_FRAME_UNCORRECTABLE;
+    }
+    if (!syndrome[0]) {
+        return CRC_FRAME_VALID;
+    }
+    if (frame->frame_bits > syndromes->max_bits) {
+        return CRC_FRAME_UNCORRECTABLE;
+    }
+
+    // A flipped bit k places from the end of the frame adds x^k to it, so leaves x^k mod G as the syndrome
+    mask = ((size_t)1 << (64 - syndromes->shift)) - 1;
+    for (slot = crc_syndrome_slot(syndromes, syndrome[0]); syndromes->syndromes[slot]; slot = (slot + 1) & mask) {
+        if (syndromes->syndromes[slot] == syndrome[0]) {
+            return syndromes->powers[slot] < frame->frame_bits ? frame->frame_bits - 1 - syndromes->powers[slot]
+                                                               : CRC_FRAME_UNCORRECTABLE;
+        }
+    }
+
+    return CRC_FRAME_UNCORRECTABLE;
+}
+
+/// Fixes a single bit error in a received frame. Returns the same as crc_locate_error
+size_t crc_fix_error(CRCFrame *frame, const CRCSyndromeTable *syndromes) {
+    size_t position;
+
+    position = crc_locate_error(frame, syndromes);
+    if (position < frame->frame_bits) {
+        bitstream_toggle(frame->frame_stream, position);
+    }
+
+    return position;
+}
+
+/// Encodes the given bitstream into a new crc frame, one bit at a time (reference implementation)
+CRCFrame* crc_encode_bitwise(const BitStream *input, const BitStream *generator) {
     CRCFrame *frame;
     BitStream *remainder;
     size_t i;
@@ -45,57 +914,673 @@ CRCFrame* crc_encode(const BitStream *input, const BitStream *generator) {
     return frame;
 }
 
+// Each byte reversed, for feeding models that take the highest bit of each byte first through the engine
+#define CRC_REVERSE2(n) (n), (n) + 2 * 64, (n) + 1 * 64, (n) + 3 * 64
+#define CRC_REVERSE4(n) CRC_REVERSE2(n), CRC_REVERSE2((n) + 2 * 16), CRC_REVERSE2((n) + 1 * 16), \
+    CRC_REVERSE2((n) + 3 * 16)
+#define CRC_REVERSE6(n) CRC_REVERSE4(n), CRC_REVERSE4((n) + 2 * 4), CRC_REVERSE4((n) + 1 * 4), \
+    CRC_REVERSE4((n) + 3 * 4)
+static const unsigned char crc_reverse_byte[256] = {
+    CRC_REVERSE6(0), CRC_REVERSE6(2), CRC_REVERSE6(1), CRC_REVERSE6(3)
+};
+
+// Number of bytes reversed at a time for models that don't reflect their input
+#define CRC_MODEL_BLOCK 4096
+
+/// Reverses the low width bits of value
+static uint64_t crc_reflect(uint64_t value, size_t width) {
+    uint64_t result;
+    size_t i;
+
+    result = 0;
+    for (i = 0; i < width; i++) {
+        result = (result << 1) | ((value >> i) & 1);
+    }
+
+    return result;
+}
+
+/// Turns a model's checksum back into the engine's register (which has the highest power in bit 0)
+static uint64_t crc_model_register(const CRCModel *model, uint64_t crc) {
+    crc ^= model->xorout;
+    return model->refout ? crc : crc_reflect(crc, model->width);
+}
+
+/// Turns the engine's register into a model's checksum
+static uint64_t crc_model_result(const CRCModel *model, uint64_t r) {
+    return (model->refout ? r : crc_reflect(r, model->width)) ^ model->xorout;
+}
+
+/// Returns the catalog model with the given name, or NULL if there isn't one
+const CRCModel* crc_model_find(const char *name) {
+    size_t i;
+
+    for (i = 0; i < crc_model_count; i++) {
+        if (!strcmp(crc_models[i].name, name)) {
+            return &crc_models[i];
+        }
+    }
+
+    return NULL;
+}
+
+/// Returns the checksum of an empty message, which is where crc_model_update starts from
+uint64_t crc_model_begin(const CRCModel *model) {
+    // init is given in normal form, and the engine's register is reflected
+    return crc_model_result(model, crc_reflect(model->init, model->width));
+}
+
+/// Given the checksum of the message so far, returns the checksum with nbytes more bytes added to the end
+uint64_t crc_model_update(const CRCModel *model, uint64_t crc, const unsigned char *bytes, size_t nbytes) {
+    unsigned char block[CRC_MODEL_BLOCK];
+    uint64_t r;
+    size_t n, i;
+
+    r = crc_model_register(model, crc);
+
+    // The engine takes the lowest bit of each byte first, which is what a reflected model wants. Otherwise the
+    // bytes are reversed a block at a time, so they can still go through the fast kernels
+    if (model->refin) {
+        crc_process(model->table, &r, bytes, nbytes * 8);
+    } else {
+        while (nbytes) {
+            n = nbytes < sizeof(block) ? nbytes : sizeof(block);
+            for (i = 0; i < n; i++) {
+                block[i] = crc_reverse_byte[bytes[i]];
+            }
+            crc_process(model->table, &r, block, n * 8);
+            bytes += n;
+            nbytes -= n;
+        }
+    }
+
+    return crc_model_result(model, r);
+}
+
+/// Returns the checksum of nbytes bytes
+uint64_t crc_model_checksum(const CRCModel *model, const unsigned char *bytes, size_t nbytes) {
+    return crc_model_update(model, crc_model_begin(model), bytes, nbytes);
+}
+
+/// Given the checksums of two messages A and B, returns the checksum of A followed by B
+uint64_t crc_model_combine(const CRCModel *model, uint64_t crc_a, uint64_t crc_b, size_t len_b) {
+    uint64_t a, b, init, shift;
+
+    a = crc_model_register(model, crc_a);
+    b = crc_model_register(model, crc_b);
+    init = crc_reflect(model->init, model->width);
+
+    // B's register started from init rather than from A's register, and the difference between the two is
+    // shifted up by the length of B, so (A - init) * x^len_b mod G is what's missing from B
+    a ^= init;
+    crc_xpow(model->table, len_b * 8, &shift);
+    crc_mulmod(model->table, &a, &shift, &a);
+
+    return crc_model_result(model, a ^ b);
+}
+
+/// Encodes input into frame: the input followed by its checksum, in the byte order the model stores it in
+int crc_model_encode_into(const CRCModel *model, const BitStream *input, BitStream *frame) {
+    uint64_t crc;
+    size_t nbytes, input_words, i;
+
+    if (input->length % 8) {
+        return -1;
+    }
+    nbytes = input->length / 8;
+    crc = crc_model_checksum(model, input->bytes, nbytes);
+
+    input_words = BITSTREAM_WORDS(input->length);
+    frame->length = input->length + model->width;
+    memcpy(frame->words, input->words, input_words * sizeof(uint64_t));
+    memset(frame->words + input_words, 0, (BITSTREAM_WORDS(frame->length) - input_words) * sizeof(uint64_t));
+
+    for (i = 0; i < model->width / 8; i++) {
+        frame->bytes[nbytes + i] = crc >> (model->refout ? 8 * i : model->width - 8 * (i + 1));
+    }
+
+    return 0;
+}
+
 /// Free memory allocated for a crc frame
 void crc_destroy(CRCFrame *frame) {
-    free(frame->frame_stream);
+    bitstream_destroy(frame->frame_stream);
+    free(frame);
 }
 
-/// Tests all hamming functions
-void crc_test() {
-    char *str, output[75];
+/// Creates a bitstream of the given length filled with random bits
+static BitStream* crc_test_random_stream(size_t length) {
+    BitStream *stream;
+    size_t i;
+
+    stream = bitstream_create(length);
+    for (i = 0; i < length; i++) {
+        bitstream_set(stream, i, rand() & 1);
+    }
+
+    return stream;
+}
+
+/// Checks that the table driven and bitwise engines agree with each other, and with the expected output
+static void crc_test_engines(const char *input_str, const char *generator_str, const char *expected) {
+    char output[75];
     BitStream *input, *generator;
     CRCFrame *frame;
 
-    printf("  => Testing CRC functions\n");
+    input = bitstream_create(strlen(input_str));
+    bitstream_read_from_string(input, input_str);
+    generator = bitstream_create(strlen(generator_str));
+    bitstream_read_from_string(generator, generator_str);
+
+    frame = crc_encode_bitwise(input, generator);
+    bitstream_write_to_string(frame->frame_stream, output);
+    assert(!strcmp(output, expected));
+    crc_destroy(frame);
 
-    str = "10011101";
-    input = bitstream_create(strlen(str));
-    bitstream_read_from_string(input, str);
-    str = "1001";
-    generator = bitstream_create(strlen(str));
-    bitstream_read_from_string(generator, str);
     frame = crc_encode(input, generator);
     bitstream_write_to_string(frame->frame_stream, output);
-    assert(!strcmp(output, "10011101100"));
+    assert(!strcmp(output, expected));
     crc_destroy(frame);
+
     bitstream_destroy(input);
     bitstream_destroy(generator);
+}
 
-    str = "1101011011";
-    input = bitstream_create(strlen(str));
-    bitstream_read_from_string(input, str);
-    str = "10011";
-    generator = bitstream_create(strlen(str));
-    bitstream_read_from_string(generator, str);
-    frame = crc_encode(input, generator);
-    bitstream_write_to_string(frame->frame_stream, output);
-    assert(!strcmp(output, "11010110111110"));
+/// Checks that the table driven and bitwise engines agree on random inputs for a range of generator lengths
+static void crc_test_random() {
+    BitStream *input, *generator;
+    CRCFrame *expected, *frame;
+    CRCTable *table;
+    size_t generator_length, input_length, i;
+
+    srand(4220);
+
+    for (generator_length = 1; generator_length <= 140; generator_length++) {
+        generator = crc_test_random_stream(generator_length);
+        table = crc_table_create(generator);
+
+        for (i = 0; i < 4; i++) {
+            input_length = rand() % 300;
+            input = crc_test_random_stream(input_length);
+
+            expected = crc_encode_bitwise(input, generator);
+            frame = crc_encode_table(input, table);
+            assert(frame->frame_bits == expected->frame_bits);
+            assert(!memcmp(frame->frame_stream->bytes, expected->frame_stream->bytes, (frame->frame_bits + 7) / 8));
+
+            crc_destroy(expected);
+            crc_destroy(frame);
+            bitstream_destroy(input);
+        }
+
+        crc_table_destroy(table);
+        bitstream_destroy(generator);
+    }
+}
+
+/// Reads the remainder from the end of a crc frame into a single word
+static uint64_t crc_test_frame_remainder(const CRCFrame *frame, size_t width) {
+    uint64_t remainder;
+    size_t i;
+
+    remainder = 0;
+    for (i = 0; i < width; i++) {
+        remainder |= (uint64_t)bitstream_get(frame->frame_stream, frame->frame_bits - width + i) << i;
+    }
+
+    return remainder;
+}
+
+/// Checks each of the single word kernels against the bitwise engine, on inputs long enough to use them
+static void crc_test_kernels() {
+    BitStream *input, *generator;
+    CRCFrame *expected;
+    CRCTable *table;
+    size_t generator_length, nbytes, i;
+    uint64_t remainder;
+
+    for (generator_length = 2; generator_length <= 65; generator_length++) {
+        generator = crc_test_random_stream(generator_length);
+        table = crc_table_create(generator);
+
+        for (i = 0; i < 3; i++) {
+            nbytes = rand() % 600;
+            input = crc_test_random_stream(nbytes * 8);
+            expected = crc_encode_bitwise(input, generator);
+            remainder = crc_test_frame_remainder(expected, table->width);
+
+            assert(crc_kernel_byte(table, 0, input->bytes, nbytes) == remainder);
+            assert(crc_kernel_slice8(table, 0, input->bytes, nbytes) == remainder);
+            assert(crc_kernel_slice16(table, 0, input->bytes, nbytes) == remainder);
+#ifdef CRC_HAVE_CLMUL
+            if (crc_cpu_has_clmul()) {
+                assert(crc_kernel_clmul(table, 0, input->bytes, nbytes) == remainder);
+            }
+#endif
+
+            crc_destroy(expected);
+            bitstream_destroy(input);
+        }
+
+        crc_table_destroy(table);
+        bitstream_destroy(generator);
+    }
+}
+
+/// Checks that feeding a message in random sized chunks gives the same remainder as encoding it all at once
+static void crc_test_incremental() {
+    BitStream *input, *generator, *remainder, *chunk;
+    CRCFrame *expected;
+    CRCContext *ctx;
+    size_t generator_length, offset, nbits, i;
+
+    for (generator_length = 1; generator_length <= 140; generator_length += 3) {
+        generator = crc_test_random_stream(generator_length);
+        input = crc_test_random_stream(rand() % 5000);
+        expected = crc_encode_bitwise(input, generator);
+
+        // Chunks don't have to be whole bytes, each one starts at bit 0 of its own buffer
+        ctx = crc_init(generator);
+        for (offset = 0; offset < input->length; offset += nbits) {
+            nbits = rand() % 700;
+            if (nbits > input->length - offset) {
+                nbits = input->length - offset;
+            }
+
+            chunk = bitstream_create(nbits);
+            for (i = 0; i < nbits; i++) {
+                bitstream_set(chunk, i, bitstream_get(input, offset + i));
+            }
+            crc_update(ctx, chunk->bytes, chunk->length);
+            bitstream_destroy(chunk);
+        }
+        remainder = crc_finalize(ctx);
+
+        assert(remainder->length == generator_length - 1);
+        for (i = 0; i < remainder->length; i++) {
+            assert(bitstream_get(remainder, i) == bitstream_get(expected->frame_stream, input->length + i));
+        }
+
+        bitstream_destroy(remainder);
+        crc_destroy(expected);
+        bitstream_destroy(input);
+        bitstream_destroy(generator);
+    }
+}
+
+/// Copies the remainder from the end of a crc frame into a new bitstream
+static BitStream* crc_test_frame_tail(const CRCFrame *frame, size_t width) {
+    BitStream *remainder;
+    size_t i;
+
+    remainder = bitstream_create(width);
+    for (i = 0; i < width; i++) {
+        bitstream_set(remainder, i, bitstream_get(frame->frame_stream, frame->frame_bits - width + i));
+    }
+
+    return remainder;
+}
+
+/// Checks that combining the remainders of two halves of a message gives the remainder of the whole message
+static void crc_test_combine() {
+    BitStream *input, *generator, *left, *right, *crc_left, *crc_right, *combined;
+    CRCFrame *expected, *frame;
+    size_t generator_length, split, i;
+
+    for (generator_length = 1; generator_length <= 140; generator_length += 3) {
+        generator = crc_test_random_stream(generator_length);
+        input = crc_test_random_stream(rand() % 3000);
+        split = input->length ? rand() % (input->length + 1) : 0;
+        expected = crc_encode_bitwise(input, generator);
+
+        left = bitstream_copy(input, split);
+        right = bitstream_create(input->length - split);
+        for (i = split; i < input->length; i++) {
+            bitstream_set(right, i - split, bitstream_get(input, i));
+        }
+
+        frame = crc_encode(left, generator);
+        crc_left = crc_test_frame_tail(frame, generator_length - 1);
+        crc_destroy(frame);
+
+        frame = crc_encode(right, generator);
+        crc_right = crc_test_frame_tail(frame, generator_length - 1);
+        crc_destroy(frame);
+
+        combined = crc_combine(crc_left, crc_right, right->length, generator);
+        assert(combined->length == generator_length - 1);
+        for (i = 0; i < combined->length; i++) {
+            assert(bitstream_get(combined, i) == bitstream_get(expected->frame_stream, input->length + i));
+        }
+
+        bitstream_destroy(combined);
+        bitstream_destroy(crc_left);
+        bitstream_destroy(crc_right);
+        bitstream_destroy(left);
+        bitstream_destroy(right);
+        crc_destroy(expected);
+        bitstream_destroy(input);
+        bitstream_destroy(generator);
+    }
+}
+
+/// Checks that splitting a message between threads gives the same frame as encoding it on one thread
+static void crc_test_parallel() {
+    BitStream *input, *generator;
+    CRCFrame *expected, *frame;
+    CRCTable *table;
+    size_t generator_length;
+
+    // Enough input for a few chunks, plus some bits that don't make a whole byte
+    input = crc_test_random_stream(CRC_PARALLEL_MIN_CHUNK * 8 * 3 + 13);
+
+    for (generator_length = 1; generator_length <= 140; generator_length += 23) {
+        generator = crc_test_random_stream(generator_length);
+        table = crc_table_create(generator);
+
+        expected = crc_encode_table(input, table);
+        frame = crc_encode_parallel(input, table, 4);
+        assert(frame->frame_bits == expected->frame_bits);
+        assert(!memcmp(frame->frame_stream->bytes, expected->frame_stream->bytes, (frame->frame_bits + 7) / 8));
+
+        crc_destroy(expected);
+        crc_destroy(frame);
+        crc_table_destroy(table);
+        bitstream_destroy(generator);
+    }
+
+    bitstream_destroy(input);
+}
+
+/// Checks that encoding into one reused buffer gives the same frames as the reference encoder, including for
+/// generators too wide for the stack remainder. Frames allocated from an arena should match too
+static void crc_test_into() {
+    BitStream *input, *generator, frame;
+    CRCFrame *expected, *arena_frame;
+    CRCTable *table;
+    Arena *arena;
+    uint64_t *words;
+    size_t generator_length, length;
+
+    words = (uint64_t*)malloc(BITSTREAM_WORDS(crc_frame_length(700, 700)) * sizeof(uint64_t));
+    frame.words = words;
+    arena = arena_create(4096);
+
+    for (generator_length = 1; generator_length <= 700; generator_length += 77) {
+        generator = crc_test_random_stream(generator_length);
+        table = crc_table_create(generator);
+
+        for (length = 0; length <= 700; length += 61) {
+            input = crc_test_random_stream(length);
+            expected = crc_encode_bitwise(input, generator);
+
+            crc_encode_into(input, table, &frame);
+            assert(frame.length == crc_frame_length(length, generator_length));
+            assert(frame.length == expected->frame_bits);
+            assert(!memcmp(frame.words, expected->frame_stream->words,
+                           BITSTREAM_WORDS(frame.length) * sizeof(uint64_t)));
+
+            arena_frame = crc_encode_in(arena, input, table);
+            assert(arena_frame->frame_bits == expected->frame_bits);
+            assert(!memcmp(arena_frame->frame_stream->words, expected->frame_stream->words,
+                           BITSTREAM_WORDS(frame.length) * sizeof(uint64_t)));
+
+            crc_destroy(expected);
+            bitstream_destroy(input);
+        }
+
+        crc_table_destroy(table);
+        bitstream_destroy(generator);
+        arena_reset(arena);
+    }
+
+    arena_destroy(arena);
+    free(words);
+}
+
+/// Checks each catalog model against its check value, and that its compile time table matches the one
+/// crc_table_create builds for its generator. Also checks updating in pieces, combining, and encoding frames
+static void crc_test_models() {
+    static const unsigned char check[] = "123456789";
+    const CRCModel *model;
+    BitStream *generator, *input, frame;
+    CRCTable *table;
+    uint64_t crc, crc_a, crc_b, words[BITSTREAM_WORDS(9 * 8 + 64)];
+    size_t m, i, split;
+    int result;
+
+    assert(crc_model_find("crc32c") == &crc_models[4]);
+    assert(!crc_model_find("crc33"));
+
+    for (m = 0; m < crc_model_count; m++) {
+        model = &crc_models[m];
+
+        // The generator, with its leading bit, in the same order as a bitstream
+        generator = bitstream_create(model->width + 1);
+        bitstream_set(generator, 0, 1);
+        for (i = 1; i <= model->width; i++) {
+            bitstream_set(generator, i, (model->poly >> (model->width - i)) & 1);
+        }
+        table = crc_table_create(generator);
+        assert(model->table->width == table->width && model->table->words == 1);
+        assert(model->table->poly[0] == table->poly[0]);
+        assert(!memcmp(model->table->table, table->table, 256 * sizeof(uint64_t)));
+        assert(!memcmp(model->table->slices, table->slices, CRC_SLICES * 256 * sizeof(uint64_t)));
+        assert(!memcmp(model->table->fold, table->fold, sizeof(table->fold)));
+        crc_table_destroy(table);
+        bitstream_destroy(generator);
+
+        // Check values, all at once and in pieces
+        assert(crc_model_checksum(model, check, 9) == model->check);
+        crc = crc_model_begin(model);
+        for (i = 0; i < 9; i += 2) {
+            crc = crc_model_update(model, crc, &check[i], i + 2 <= 9 ? 2 : 1);
+        }
+        assert(crc == model->check);
+
+        // Combining the checksums of two halves, for inputs long enough to use every kernel
+        input = crc_test_random_stream(8 * (rand() % 5000 + 1));
+        split = rand() % (input->length / 8 + 1);
+        crc_a = crc_model_checksum(model, input->bytes, split);
+        crc_b = crc_model_checksum(model, &input->bytes[split], input->length / 8 - split);
+        assert(crc_model_combine(model, crc_a, crc_b, input->length / 8 - split) ==
+               crc_model_checksum(model, input->bytes, input->length / 8));
+        bitstream_destroy(input);
+
+        // The frame is the message followed by the checksum's bytes
+        input = bitstream_create(9 * 8);
+        memcpy(input->bytes, check, 9);
+        frame.words = words;
+        result = crc_model_encode_into(model, input, &frame);
+        assert(result == 0);
+        assert(frame.length == 9 * 8 + model->width);
+        assert(!memcmp(frame.bytes, check, 9));
+        crc = 0;
+        for (i = 0; i < model->width / 8; i++) {
+            crc |= (uint64_t)frame.bytes[9 + i] << (model->refout ? 8 * i : model->width - 8 * (i + 1));
+        }
+        assert(crc == model->check);
+        input->length = 9 * 8 - 3;
+        result = crc_model_encode_into(model, input, &frame);
+        assert(result < 0);
+        bitstream_destroy(input);
+    }
+
+    // Known frames
+    assert(crc_model_checksum(crc_model_find("crc32"), (const unsigned char*)"", 0) == 0);
+    assert(crc_model_checksum(crc_model_find("crc32"), (const unsigned char*)"a", 1) == 0xe8b7be43);
+}
+
+/// Checks that updating a frame's remainder after flipping bits gives the same frame as encoding it again
+static void crc_test_update_bits() {
+    BitStream *input, *generator;
+    CRCFrame *frame, *expected;
+    CRCTable *table;
+    size_t positions[20], generator_length, count, round, i;
+    uint64_t before;
+    int result;
+
+    for (generator_length = 1; generator_length <= 140; generator_length += 3) {
+        generator = crc_test_random_stream(generator_length);
+        table = crc_table_create(generator);
+        input = crc_test_random_stream(1 + rand() % 3000);
+        frame = crc_encode_table(input, table);
+
+        for (round = 0; round < 5; round++) {
+            // Flip some bits in both the input and the frame (with some repeats, which cancel out)
+            count = rand() % 20;
+            for (i = 0; i < count; i++) {
+                positions[i] = i && rand() % 4 == 0 ? positions[i - 1] : rand() % input->length;
+                bitstream_toggle(input, positions[i]);
+                bitstream_toggle(frame->frame_stream, positions[i]);
+            }
+            result = crc_update_bits(frame, table, positions, count);
+            assert(result == 0);
+
+            expected = crc_encode_table(input, table);
+            assert(!memcmp(frame->frame_stream->words, expected->frame_stream->words,
+                           BITSTREAM_WORDS(frame->frame_bits) * sizeof(uint64_t)));
+            crc_destroy(expected);
+        }
+
+        // Positions in the remainder aren't part of the message, and leave the frame alone
+        if (table->width) {
+            before = bitstream_read_bits(frame->frame_stream, input->length, table->width < 64 ? table->width : 64);
+            positions[0] = 0;
+            positions[1] = input->length;
+            result = crc_update_bits(frame, table, positions, 2);
+            assert(result == -1);
+            assert(bitstream_read_bits(frame->frame_stream, input->length, table->width < 64 ? table->width : 64) ==
+                   before);
+        }
+
+        crc_destroy(frame);
+        bitstream_destroy(input);
+        crc_table_destroy(table);
+        bitstream_destroy(generator);
+    }
+}
+
+/// Checks that verification passes good frames and fails damaged ones, and that single bit errors are found
+static void crc_test_verify() {
+    BitStream *input, *generator;
+    CRCFrame *frame;
+    CRCTable *table;
+    CRCSyndromeTable *syndromes;
+    size_t generator_length, position, other, fixed, i;
+
+    for (generator_length = 2; generator_length <= 140; generator_length += 3) {
+        // A generator ending in 1 (not a multiple of x) always catches a single bit error
+        generator = crc_test_random_stream(generator_length);
+        bitstream_set(generator, 0, 1);
+        bitstream_set(generator, generator_length - 1, 1);
+        table = crc_table_create(generator);
+        syndromes = crc_syndrome_table_create(table, 1000);
+        assert(!syndromes == (generator_length > 65));
+
+        for (i = 0; i < 4; i++) {
+            input = crc_test_random_stream(rand() % 700);
+            frame = crc_encode_table(input, table);
+            assert(crc_verify_table(frame, table));
+            assert(crc_verify(frame, generator));
+
+            position = rand() % frame->frame_bits;
+            bitstream_toggle(frame->frame_stream, position);
+            assert(!crc_verify_table(frame, table));
+
+            if (syndromes) {
+                // Within the generator's period, the error is found and fixed
+                if (frame->frame_bits <= syndromes->max_bits) {
+                    assert(crc_locate_error(frame, syndromes) == position);
+                    fixed = crc_fix_error(frame, syndromes);
+                    assert(fixed == position);
+                    assert(crc_verify_table(frame, table));
+                    assert(crc_locate_error(frame, syndromes) == CRC_FRAME_VALID);
+                } else {
+                    assert(crc_locate_error(frame, syndromes) == CRC_FRAME_UNCORRECTABLE);
+                }
+            }
+
+            crc_destroy(frame);
+            bitstream_destroy(input);
+        }
+
+        if (syndromes) {
+            crc_syndrome_table_destroy(syndromes);
+        }
+        crc_table_destroy(table);
+        bitstream_destroy(generator);
+    }
+
+    // x^3 + x + 1 is primitive, so its syndromes come round after 7 bits (a 4 bit message and its remainder)
+    generator = bitstream_create(4);
+    bitstream_read_from_string(generator, "1011");
+    table = crc_table_create(generator);
+    syndromes = crc_syndrome_table_create(table, 100);
+    assert(syndromes->max_bits == 7);
+    input = bitstream_create(4);
+    bitstream_read_from_string(input, "1101");
+    frame = crc_encode_table(input, table);
+    for (position = 0; position < 7; position++) {
+        bitstream_toggle(frame->frame_stream, position);
+        fixed = crc_fix_error(frame, syndromes);
+        assert(fixed == position);
+        assert(crc_verify_table(frame, table));
+    }
     crc_destroy(frame);
     bitstream_destroy(input);
+    crc_syndrome_table_destroy(syndromes);
+    crc_table_destroy(table);
     bitstream_destroy(generator);
 
-    str = "1101011011011100";
-    input = bitstream_create(strlen(str));
-    bitstream_read_from_string(input, str);
-    str = "1101110111011101";
-    generator = bitstream_create(strlen(str));
-    bitstream_read_from_string(generator, str);
-    frame = crc_encode(input, generator);
-    bitstream_write_to_string(frame->frame_stream, output);
-    assert(!strcmp(output, "1101011011011100110101101101110"));
+    // The crc32 generator has a distance of at least 4 at this length, so two flipped bits can't look like one
+    generator = bitstream_create(33);
+    bitstream_read_from_string(generator, "100000100110000010001110110110111");
+    table = crc_table_create(generator);
+    syndromes = crc_syndrome_table_create(table, 1000);
+    input = crc_test_random_stream(900);
+    frame = crc_encode_table(input, table);
+    for (i = 0; i < 50; i++) {
+        position = rand() % frame->frame_bits;
+        other = (position + 1 + rand() % (frame->frame_bits - 1)) % frame->frame_bits;
+        bitstream_toggle(frame->frame_stream, position);
+        bitstream_toggle(frame->frame_stream, other);
+        assert(crc_locate_error(frame, syndromes) == CRC_FRAME_UNCORRECTABLE);
+        bitstream_toggle(frame->frame_stream, position);
+        bitstream_toggle(frame->frame_stream, other);
+    }
+    assert(crc_locate_error(frame, syndromes) == CRC_FRAME_VALID);
+
+    // Frames too short to hold a remainder fail
+    frame->frame_bits = 10;
+    assert(!crc_verify_table(frame, table));
+    assert(crc_locate_error(frame, syndromes) == CRC_FRAME_UNCORRECTABLE);
+    frame->frame_bits = 932;
+
     crc_destroy(frame);
     bitstream_destroy(input);
+    crc_syndrome_table_destroy(syndromes);
+    crc_table_destroy(table);
     bitstream_destroy(generator);
+}
+
+/// Tests all crc functions
+void crc_test() {
+    printf("  => Testing CRC functions\n");
+
+    crc_test_engines("10011101", "1001", "10011101100");
+    crc_test_engines("1101011011", "10011", "11010110111110");
+    crc_test_engines("1101011011011100", "1101110111011101", "1101011011011100110101101101110");
+    crc_test_engines("1101", "1", "1101");
+    crc_test_random();
+    crc_test_kernels();
+    crc_test_incremental();
+    crc_test_combine();
+    crc_test_parallel();
+    crc_test_into();
+    crc_test_models();
+    crc_test_update_bits();
+    crc_test_verify();
 
     printf("    => CRC tests passed!\n");
 }
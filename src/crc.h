@@ -1,16 +1,181 @@
 #ifndef __CRC_H__
 #define __CRC_H__
 
+#include <stdint.h>
 #include <bitstream.h>
 
+/// Number of lookup tables built for the slicing kernels (generators of up to 65 bits)
+#define CRC_SLICES 16
+
+/// Number of 64 bit words of remainder crc_encode_into keeps on the stack (generators of up to 513 bits)
+#define CRC_STACK_WORDS 8
+
 typedef struct {
     BitStream *frame_stream;
     size_t frame_bits;
 } CRCFrame;
 
+/// Lookup table for the table driven crc engine, built once from a generator.
+///
+/// The remainder is kept in the same bit order as a bitstream (bit 0 is the highest power), padded out to a
+/// whole number of 64 bit words, so any generator length can be used.
+typedef struct {
+    size_t width;               // Number of bits in the remainder (generator->length - 1)
+    size_t words;               // Number of 64 bit words needed to hold the remainder
+    const uint64_t *poly;       // The generator without its leading bit, as `words` words
+    const uint64_t *table;      // 256 entries of `words` words, indexed by the next byte of input
+    const uint64_t *slices;     // CRC_SLICES tables of 256 entries for the slicing kernels (only when words == 1)
+    uint64_t fold[8];           // Constants for folding 512, 384, 256 and 128 bits forward (only when words == 1)
+} CRCTable;
+
+/// State for calculating a crc incrementally, as the message arrives in chunks
+typedef struct {
+    const CRCTable *table;
+    CRCTable *owned_table;  // Set when the table was built by crc_init, and should be freed with the context
+    uint64_t *remainder;    // The remainder so far, in the same layout as the table entries
+    size_t bits;            // Number of message bits fed in so far
+} CRCContext;
+
+/// Returned by crc_locate_error for a frame with a remainder of 0
+#define CRC_FRAME_VALID ((size_t)-1)
+/// Returned by crc_locate_error for a frame whose error isn't a single bit it can find
+#define CRC_FRAME_UNCORRECTABLE ((size_t)-2)
+
+/// Lookup from the syndrome of a single bit error (x^k mod G, for an error k bits from the end of the frame) to k,
+/// for generators of up to 65 bits. Only built for frames of up to max_bits bits, and no longer than the period of
+/// the generator, past which two positions would share a syndrome
+typedef struct {
+    const CRCTable *table;
+    size_t max_bits;            // Longest frame whose single bit errors can all be told apart
+    unsigned int shift;         // 64 - log2 of the number of slots, for hashing a syndrome to a slot
+    uint64_t *syndromes;        // The syndrome in each slot, or 0 for an empty slot
+    size_t *powers;             // The power k the syndrome in each slot is for
+} CRCSyndromeTable;
+
+/// A standard crc, as described in crc catalogs: the generator, the register's starting value, whether each byte
+/// is taken lowest bit first (refin) and the register is read out reversed (refout), and a value xored into the result.
+///
+/// Models work on whole bytes and give the checksum as a number, the same as other implementations of them
+typedef struct {
+    const char *name;
+    size_t width;               // Number of bits in the checksum (up to 64)
+    uint64_t poly;              // The generator in normal form: without its leading bit, highest power first
+    uint64_t init;              // Starting value of the register (before any reflection)
+    int refin, refout;
+    uint64_t xorout;
+    uint64_t check;             // Checksum of the ascii string "123456789"
+    const CRCTable *table;      // Built at compile time, so it must not be passed to crc_table_destroy
+} CRCModel;
+
+/// The built in models: crc8, crc16, crc16-ccitt, crc32, crc32c, crc64-xz and crc64-ecma
+extern const CRCModel crc_models[];
+/// Number of models in crc_models
+extern const size_t crc_model_count;
+
+/// Builds the lookup table for the given generator
+CRCTable* crc_table_create(const BitStream *generator);
+
+/// Free memory allocated for a crc table
+void crc_table_destroy(CRCTable *table);
+
 /// Encodes the given bitstream into a new crc frame
 CRCFrame* crc_encode(const BitStream *input, const BitStream *generator);
 
+/// Encodes the given bitstream into a new crc frame, using a table built by crc_table_create
+CRCFrame* crc_encode_table(const BitStream *input, const CRCTable *table);
+
+/// Encodes the given bitstream into a new crc frame allocated from an arena (freed by arena_reset, not crc_destroy),
+/// using a table built by crc_table_create
+CRCFrame* crc_encode_in(Arena *arena, const BitStream *input, const CRCTable *table);
+
+/// Given a message length and the length of the generator (both in bits), returns the number of bits in the crc
+/// frame for that message
+size_t crc_frame_length(size_t message_length, size_t generator_length);
+
+/// Encodes input into frame, a caller owned stream with room for crc_frame_length(input->length, generator length)
+/// bits. Sets the length of frame, and only allocates memory for generators wider than CRC_STACK_WORDS words
+/// (frame must not be input)
+void crc_encode_into(const BitStream *input, const CRCTable *table, BitStream *frame);
+
+/// Encodes the given bitstream into a new crc frame, splitting the work between the given number of threads.
+/// Each chunk's remainder is calculated on its own, and they are merged with crc_combine_table.
+CRCFrame* crc_encode_parallel(const BitStream *input, const CRCTable *table, size_t threads);
+
+/// Encodes input into frame (a caller owned stream, like crc_encode_into), splitting the work between the given
+/// number of threads
+void crc_encode_parallel_into(const BitStream *input, const CRCTable *table, size_t threads, BitStream *frame);
+
+/// Encodes the given bitstream into a new crc frame, one bit at a time (reference implementation)
+CRCFrame* crc_encode_bitwise(const BitStream *input, const BitStream *generator);
+
+/// Starts a new incremental crc calculation for the given generator
+CRCContext* crc_init(const BitStream *generator);
+
+/// Starts a new incremental crc calculation with an existing table, which must outlive the context
+CRCContext* crc_init_table(const CRCTable *table);
+
+/// Feeds the next nbits bits of the message (stored the same way as a bitstream) into the calculation
+void crc_update(CRCContext *ctx, const unsigned char *bytes, size_t nbits);
+
+/// Finishes an incremental crc calculation, returning the remainder and freeing the context
+BitStream* crc_finalize(CRCContext *ctx);
+
+/// Given the remainders of two messages A and B, calculates the remainder of A followed by B.
+/// len_b is the length of B in bits, and the work done is O(log len_b) polynomial multiplications.
+BitStream* crc_combine(const BitStream *crc_a, const BitStream *crc_b, size_t len_b, const BitStream *generator);
+
+/// Given the remainders of two messages A and B, calculates the remainder of A followed by B, using an existing table
+BitStream* crc_combine_table(const BitStream *crc_a, const BitStream *crc_b, size_t len_b, const CRCTable *table);
+
+/// Updates the remainder of a frame after bits of its message were flipped in place, without going over the rest of
+/// the message. positions are the flipped bits (a position given twice cancels out), and the work done is
+/// O(count * log frame_bits) polynomial multiplications. Returns 0 on success, or -1 (leaving the frame unchanged) if
+/// a position isn't in the message
+int crc_update_bits(CRCFrame *frame, const CRCTable *table, const size_t *positions, size_t count);
+
+/// Checks a received frame (a message followed by its remainder), returning 1 if its remainder is 0, or 0 if it has
+/// errors. The remainder is found in a single table driven pass, without building a new frame
+int crc_verify(const CRCFrame *frame, const BitStream *generator);
+
+/// Checks a received frame, like crc_verify, using a table built by crc_table_create
+int crc_verify_table(const CRCFrame *frame, const CRCTable *table);
+
+/// Builds the syndrome lookup for single bit errors in frames of up to max_bits bits, with a table built by
+/// crc_table_create (which must outlive it). Returns NULL for generators wider than 65 bits
+CRCSyndromeTable* crc_syndrome_table_create(const CRCTable *table, size_t max_bits);
+
+/// Free memory allocated for a syndrome table
+void crc_syndrome_table_destroy(CRCSyndromeTable *syndromes);
+
+/// Returns the position of the bit in error in a received frame, CRC_FRAME_VALID if it has no errors, or
+/// CRC_FRAME_UNCORRECTABLE if the error isn't a single bit (or the frame is longer than the table was built for).
+/// An error in 3 or more bits can share a syndrome with a single bit error, so it can still be located wrongly
+size_t crc_locate_error(const CRCFrame *frame, const CRCSyndromeTable *syndromes);
+
+/// Fixes a single bit error in a received frame. Returns the same as crc_locate_error
+size_t crc_fix_error(CRCFrame *frame, const CRCSyndromeTable *syndromes);
+
+/// Returns the catalog model with the given name, or NULL if there isn't one
+const CRCModel* crc_model_find(const char *name);
+
+/// Returns the checksum of an empty message, which is where crc_model_update starts from
+uint64_t crc_model_begin(const CRCModel *model);
+
+/// Given the checksum of the message so far, returns the checksum with nbytes more bytes added to the end
+uint64_t crc_model_update(const CRCModel *model, uint64_t crc, const unsigned char *bytes, size_t nbytes);
+
+/// Returns the checksum of nbytes bytes
+uint64_t crc_model_checksum(const CRCModel *model, const unsigned char *bytes, size_t nbytes);
+
+/// Given the checksums of two messages A and B, returns the checksum of A followed by B. len_b is the length of B
+/// in bytes, and the work done is O(log len_b) polynomial multiplications
+uint64_t crc_model_combine(const CRCModel *model, uint64_t crc_a, uint64_t crc_b, size_t len_b);
+
+/// Encodes input into frame (a caller owned stream with room for input->length + model->width bits): the input
+/// followed by its checksum, in the byte order the model stores it in (lowest byte first when refout is set, highest
+/// byte first otherwise). Returns 0 on success, or -1 if the input isn't a whole number of bytes
+int crc_model_encode_into(const CRCModel *model, const BitStream *input, BitStream *frame);
+
 /// Free memory allocated for a crc frame
 void crc_destroy(CRCFrame *frame);
 
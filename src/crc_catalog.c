@@ -0,0 +1,246 @@
+#include <crc.h>
+
+// The lookup tables for the catalog are worked out by the compiler, so using a model costs nothing at startup.
+//
+// Every table of the slicing kernels is linear (entry a ^ b is entry a ^ entry b), so all 256 entries can be
+// built from the entries for the 8 single bit bytes. Those (and the folding constants) are the values
+// crc_table_create gives for each generator, which crc_test checks.
+
+/// Entry i of a slicing table, from the table's entries for bytes 0x01, 0x02, 0x04, ... 0x80
+#define CRC_ENTRY(i, b0, b1, b2, b3, b4, b5, b6, b7) \
+    ((uint64_t)((i) & 0x01 ? (b0) : 0) ^ ((i) & 0x02 ? (b1) : 0) ^ ((i) & 0x04 ? (b2) : 0) ^ \
+     ((i) & 0x08 ? (b3) : 0) ^ ((i) & 0x10 ? (b4) : 0) ^ ((i) & 0x20 ? (b5) : 0) ^ \
+     ((i) & 0x40 ? (b6) : 0) ^ ((i) & 0x80 ? (b7) : 0))
+#define CRC_ENTRY4(i, ...) \
+    CRC_ENTRY((i), __VA_ARGS__), CRC_ENTRY((i) + 1, __VA_ARGS__), \
+    CRC_ENTRY((i) + 2, __VA_ARGS__), CRC_ENTRY((i) + 3, __VA_ARGS__)
+#define CRC_ENTRY16(i, ...) \
+    CRC_ENTRY4((i), __VA_ARGS__), CRC_ENTRY4((i) + 4, __VA_ARGS__), \
+    CRC_ENTRY4((i) + 8, __VA_ARGS__), CRC_ENTRY4((i) + 12, __VA_ARGS__)
+#define CRC_ENTRY64(i, ...) \
+    CRC_ENTRY16((i), __VA_ARGS__), CRC_ENTRY16((i) + 16, __VA_ARGS__), \
+    CRC_ENTRY16((i) + 32, __VA_ARGS__), CRC_ENTRY16((i) + 48, __VA_ARGS__)
+/// All 256 entries of a slicing table
+#define CRC_SLICE(...) \
+    CRC_ENTRY64(0, __VA_ARGS__), CRC_ENTRY64(64, __VA_ARGS__), \
+    CRC_ENTRY64(128, __VA_ARGS__), CRC_ENTRY64(192, __VA_ARGS__)
+
+// CRC-8 (x^8 + x^2 + x + 1)
+static const uint64_t crc8_slices[CRC_SLICES * 256] = {
+    CRC_SLICE(0x91, 0xe3, 0x07, 0x0e, 0x1c, 0x38, 0x70, 0xe0),
+    CRC_SLICE(0x6d, 0xda, 0x75, 0xea, 0x15, 0x2a, 0x54, 0xa8),
+    CRC_SLICE(0xd0, 0x61, 0xc2, 0x45, 0x8a, 0xd5, 0x6b, 0xd6),
+    CRC_SLICE(0x8c, 0xd9, 0x73, 0xe6, 0x0d, 0x1a, 0x34, 0x68),
+    CRC_SLICE(0xe9, 0x13, 0x26, 0x4c, 0x98, 0xf1, 0x23, 0x46),
+    CRC_SLICE(0x37, 0x6e, 0xdc, 0x79, 0xf2, 0x25, 0x4a, 0x94),
+    CRC_SLICE(0x51, 0xa2, 0x85, 0xcb, 0x57, 0xae, 0x9d, 0xfb),
+    CRC_SLICE(0xfd, 0x3b, 0x76, 0xec, 0x19, 0x32, 0x64, 0xc8),
+    CRC_SLICE(0x2c, 0x58, 0xb0, 0xa1, 0x83, 0xc7, 0x4f, 0x9e),
+    CRC_SLICE(0x31, 0x62, 0xc4, 0x49, 0x92, 0xe5, 0x0b, 0x16),
+    CRC_SLICE(0xb5, 0xab, 0x97, 0xef, 0x1f, 0x3e, 0x7c, 0xf8),
+    CRC_SLICE(0x52, 0xa4, 0x89, 0xd3, 0x67, 0xce, 0x5d, 0xba),
+    CRC_SLICE(0x8f, 0xdf, 0x7f, 0xfe, 0x3d, 0x7a, 0xf4, 0x29),
+    CRC_SLICE(0x9b, 0xf7, 0x2f, 0x5e, 0xbc, 0xb9, 0xb3, 0xa7),
+    CRC_SLICE(0x80, 0xc1, 0x43, 0x86, 0xcd, 0x5b, 0xb6, 0xad),
+    CRC_SLICE(0xe0, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40),
+};
+
+static const uint64_t crc8_poly[1] = {0xe0};
+
+static const CRCTable crc8_table = {
+    .width = 8,
+    .words = 1,
+    .poly = crc8_poly,
+    .table = crc8_slices,
+    .slices = crc8_slices,
+    .fold = {0x1c, 0xc7, 0x38, 0x4f, 0x70, 0x9e, 0xe0, 0xfd},
+};
+
+// CRC-16 (x^16 + x^15 + x^2 + 1)
+static const uint64_t crc16_slices[CRC_SLICES * 256] = {
+    CRC_SLICE(0xc0c1, 0xc181, 0xc301, 0xc601, 0xcc01, 0xd801, 0xf001, 0xa001),
+    CRC_SLICE(0x9001, 0x6001, 0xc002, 0xc007, 0xc00d, 0xc019, 0xc031, 0xc061),
+    CRC_SLICE(0xc051, 0xc0a1, 0xc141, 0xc281, 0xc501, 0xca01, 0xd401, 0xe801),
+    CRC_SLICE(0xfc01, 0xb801, 0x3001, 0x6002, 0xc004, 0xc00b, 0xc015, 0xc029),
+    CRC_SLICE(0xc03d, 0xc079, 0xc0f1, 0xc1e1, 0xc3c1, 0xc781, 0xcf01, 0xde01),
+    CRC_SLICE(0xd101, 0xe201, 0x8401, 0x4801, 0x9002, 0x6007, 0xc00e, 0xc01f),
+    CRC_SLICE(0xc010, 0xc023, 0xc045, 0xc089, 0xc111, 0xc221, 0xc441, 0xc881),
+    CRC_SLICE(0xccc1, 0xd981, 0xf301, 0xa601, 0x0c01, 0x1802, 0x3004, 0x6008),
+    CRC_SLICE(0x900d, 0x6019, 0xc032, 0xc067, 0xc0cd, 0xc199, 0xc331, 0xc661),
+    CRC_SLICE(0xc551, 0xcaa1, 0xd541, 0xea81, 0x9501, 0x6a01, 0xd402, 0xe807),
+    CRC_SLICE(0xfc04, 0xb80b, 0x3015, 0x602a, 0xc054, 0xc0ab, 0xc155, 0xc2a9),
+    CRC_SLICE(0xc3fd, 0xc7f9, 0xcff1, 0xdfe1, 0xffc1, 0xbf81, 0x3f01, 0x7e02),
+    CRC_SLICE(0x8102, 0x4207, 0x840e, 0x481f, 0x903e, 0x607f, 0xc0fe, 0xc1ff),
+    CRC_SLICE(0xc100, 0xc203, 0xc405, 0xc809, 0xd011, 0xe021, 0x8041, 0x4081),
+    CRC_SLICE(0x00c1, 0x0182, 0x0304, 0x0608, 0x0c10, 0x1820, 0x3040, 0x6080),
+    CRC_SLICE(0x90c1, 0x6181, 0xc302, 0xc607, 0xcc0d, 0xd819, 0xf031, 0xa061),
+};
+
+static const uint64_t crc16_poly[1] = {0xa001};
+
+static const CRCTable crc16_table = {
+    .width = 16,
+    .words = 1,
+    .poly = crc16_poly,
+    .table = crc16_slices,
+    .slices = crc16_slices,
+    .fold = {0xf0c1, 0xbffa, 0xed6d, 0xc6ad, 0xac01, 0x955d, 0x90c1, 0xccc1},
+};
+
+// CRC-16-CCITT (x^16 + x^12 + x^5 + 1)
+static const uint64_t crc16_ccitt_slices[CRC_SLICES * 256] = {
+    CRC_SLICE(0x1189, 0x2312, 0x4624, 0x8c48, 0x1081, 0x2102, 0x4204, 0x8408),
+    CRC_SLICE(0x19d8, 0x33b0, 0x6760, 0xcec0, 0x9591, 0x2333, 0x4666, 0x8ccc),
+    CRC_SLICE(0x5adc, 0xb5b8, 0x6361, 0xc6c2, 0x8595, 0x033b, 0x0676, 0x0cec),
+    CRC_SLICE(0x1cbb, 0x3976, 0x72ec, 0xe5d8, 0xc3a1, 0x8f53, 0x16b7, 0x2d6e),
+    CRC_SLICE(0x0b44, 0x1688, 0x2d10, 0x5a20, 0xb440, 0x6091, 0xc122, 0x8a55),
+    CRC_SLICE(0x042b, 0x0856, 0x10ac, 0x2158, 0x42b0, 0x8560, 0x02d1, 0x05a2),
+    CRC_SLICE(0x9fd5, 0x37bb, 0x6f76, 0xdeec, 0xb5c9, 0x6383, 0xc706, 0x861d),
+    CRC_SLICE(0x81bf, 0x0b6f, 0x16de, 0x2dbc, 0x5b78, 0xb6f0, 0x65f1, 0xcbe2),
+    CRC_SLICE(0x4dfd, 0x9bfa, 0x3fe5, 0x7fca, 0xff94, 0xf739, 0xe663, 0xc4d7),
+    CRC_SLICE(0x2c27, 0x584e, 0xb09c, 0x6929, 0xd252, 0xacb5, 0x517b, 0xa2f6),
+    CRC_SLICE(0x5591, 0xab22, 0x5e55, 0xbcaa, 0x7145, 0xe28a, 0xcd05, 0x921b),
+    CRC_SLICE(0x8555, 0x02bb, 0x0576, 0x0aec, 0x15d8, 0x2bb0, 0x5760, 0xaec0),
+    CRC_SLICE(0x05ad, 0x0b5a, 0x16b4, 0x2d68, 0x5ad0, 0xb5a0, 0x6351, 0xc6a2),
+    CRC_SLICE(0x7eea, 0xfdd4, 0xf3b9, 0xef63, 0xd6d7, 0xa5bf, 0x436f, 0x86de),
+    CRC_SLICE(0x482a, 0x9054, 0x28b9, 0x5172, 0xa2e4, 0x4dd9, 0x9bb2, 0x3f75),
+    CRC_SLICE(0x8e10, 0x1431, 0x2862, 0x50c4, 0xa188, 0x4b01, 0x9602, 0x2415),
+};
+
+static const uint64_t crc16_ccitt_poly[1] = {0x8408};
+
+static const CRCTable crc16_ccitt_table = {
+    .width = 16,
+    .words = 1,
+    .poly = crc16_ccitt_poly,
+    .table = crc16_ccitt_slices,
+    .slices = crc16_ccitt_slices,
+    .fold = {0x922d, 0x47e3, 0x4d7a, 0x0e3a, 0x7762, 0x5b44, 0x8e10, 0x81bf},
+};
+
+// CRC-32 (IEEE 802.3)
+static const uint64_t crc32_slices[CRC_SLICES * 256] = {
+    CRC_SLICE(0x77073096, 0xee0e612c, 0x076dc419, 0x0edb8832, 0x1db71064, 0x3b6e20c8, 0x76dc4190, 0xedb88320),
+    CRC_SLICE(0x191b3141, 0x32366282, 0x646cc504, 0xc8d98a08, 0x4ac21251, 0x958424a2, 0xf0794f05, 0x3b83984b),
+    CRC_SLICE(0x01c26a37, 0x0384d46e, 0x0709a8dc, 0x0e1351b8, 0x1c26a370, 0x384d46e0, 0x709a8dc0, 0xe1351b80),
+    CRC_SLICE(0xb8bc6765, 0xaa09c88b, 0x8f629757, 0xc5b428ef, 0x5019579f, 0xa032af3e, 0x9b14583d, 0xed59b63b),
+    CRC_SLICE(0x3d6029b0, 0x7ac05360, 0xf580a6c0, 0x30704bc1, 0x60e09782, 0xc1c12f04, 0x58f35849, 0xb1e6b092),
+    CRC_SLICE(0xcb5cd3a5, 0x4dc8a10b, 0x9b914216, 0xec53826d, 0x03d6029b, 0x07ac0536, 0x0f580a6c, 0x1eb014d8),
+    CRC_SLICE(0xa6770bb4, 0x979f1129, 0xf44f2413, 0x33ef4e67, 0x67de9cce, 0xcfbd399c, 0x440b7579, 0x8816eaf2),
+    CRC_SLICE(0xccaa009e, 0x4225077d, 0x844a0efa, 0xd3e51bb5, 0x7cbb312b, 0xf9766256, 0x299dc2ed, 0x533b85da),
+    CRC_SLICE(0x177b1443, 0x2ef62886, 0x5dec510c, 0xbbd8a218, 0xacc04271, 0x82f182a3, 0xde920307, 0x6655004f),
+    CRC_SLICE(0xefc26b3e, 0x04f5d03d, 0x09eba07a, 0x13d740f4, 0x27ae81e8, 0x4f5d03d0, 0x9eba07a0, 0xe6050901),
+    CRC_SLICE(0xc18edfc0, 0x586cb9c1, 0xb0d97382, 0xbac3e145, 0xaef6c4cb, 0x869c8fd7, 0xd64819ef, 0x77e1359f),
+    CRC_SLICE(0x9ba54c6f, 0xec3b9e9f, 0x03063b7f, 0x060c76fe, 0x0c18edfc, 0x1831dbf8, 0x3063b7f0, 0x60c76fe0),
+    CRC_SLICE(0xdd96d985, 0x605cb54b, 0xc0b96a96, 0x5a03d36d, 0xb407a6da, 0xb37e4bf5, 0xbd8d91ab, 0xa06a2517),
+    CRC_SLICE(0x9d0fe176, 0xe16ec4ad, 0x19ac8f1b, 0x33591e36, 0x66b23c6c, 0xcd6478d8, 0x41b9f7f1, 0x8373efe2),
+    CRC_SLICE(0xb9fbdbe8, 0xa886b191, 0x8a7c6563, 0xcf89cc87, 0x44629f4f, 0x88c53e9e, 0xcafb7b7d, 0x4e87f0bb),
+    CRC_SLICE(0xae689191, 0x87a02563, 0xd4314c87, 0x73139f4f, 0xe6273e9e, 0x173f7b7d, 0x2e7ef6fa, 0x5cfdedf4),
+};
+
+static const uint64_t crc32_poly[1] = {0xedb88320};
+
+static const CRCTable crc32_table = {
+    .width = 32,
+    .words = 1,
+    .poly = crc32_poly,
+    .table = crc32_slices,
+    .slices = crc32_slices,
+    .fold = {0x8f352d95, 0x1d9513d7, 0x3db1ecdc, 0xaf449247, 0xf1da05aa, 0x81256527, 0xae689191, 0xccaa009e},
+};
+
+// CRC-32C (Castagnoli)
+static const uint64_t crc32c_slices[CRC_SLICES * 256] = {
+    CRC_SLICE(0xf26b8303, 0xe13b70f7, 0xc79a971f, 0x8ad958cf, 0x105ec76f, 0x20bd8ede, 0x417b1dbc, 0x82f63b78),
+    CRC_SLICE(0x13a29877, 0x274530ee, 0x4e8a61dc, 0x9d14c3b8, 0x3fc5f181, 0x7f8be302, 0xff17c604, 0xfbc3faf9),
+    CRC_SLICE(0xa541927e, 0x4f6f520d, 0x9edea41a, 0x38513ec5, 0x70a27d8a, 0xe144fb14, 0xc76580d9, 0x8b277743),
+    CRC_SLICE(0xdd45aab8, 0xbf672381, 0x7b2231f3, 0xf64463e6, 0xe964b13d, 0xd725148b, 0xaba65fe7, 0x52a0c93f),
+    CRC_SLICE(0x38116fac, 0x7022df58, 0xe045beb0, 0xc5670b91, 0x8f2261d3, 0x1ba8b557, 0x37516aae, 0x6ea2d55c),
+    CRC_SLICE(0xef306b19, 0xdb8ca0c3, 0xb2f53777, 0x6006181f, 0xc00c303e, 0x85f4168d, 0x0e045beb, 0x1c08b7d6),
+    CRC_SLICE(0x68032cc8, 0xd0065990, 0xa5e0c5d1, 0x4e2dfd53, 0x9c5bfaa6, 0x3d5b83bd, 0x7ab7077a, 0xf56e0ef4),
+    CRC_SLICE(0x493c7d27, 0x9278fa4e, 0x211d826d, 0x423b04da, 0x847609b4, 0x0d006599, 0x1a00cb32, 0x34019664),
+    CRC_SLICE(0xf43ed648, 0xed91da61, 0xdecfc233, 0xb873f297, 0x750b93df, 0xea1727be, 0xd1c2398d, 0xa66805eb),
+    CRC_SLICE(0xcb567ba5, 0x934081bb, 0x236d7587, 0x46daeb0e, 0x8db5d61c, 0x1e87dac9, 0x3d0fb592, 0x7a1f6b24),
+    CRC_SLICE(0x9771f7c1, 0x2b0f9973, 0x561f32e6, 0xac3e65cc, 0x5d90bd69, 0xbb217ad2, 0x73ae8355, 0xe75d06aa),
+    CRC_SLICE(0x3171d430, 0x62e3a860, 0xc5c750c0, 0x8e62d771, 0x1929d813, 0x3253b026, 0x64a7604c, 0xc94ec098),
+    CRC_SLICE(0x30d23865, 0x61a470ca, 0xc348e194, 0x837db5d9, 0x03171d43, 0x062e3a86, 0x0c5c750c, 0x18b8ea18),
+    CRC_SLICE(0x54075546, 0xa80eaa8c, 0x55f123e9, 0xabe247d2, 0x5228f955, 0xa451f2aa, 0x4d4f93a5, 0x9a9f274a),
+    CRC_SLICE(0x678efd01, 0xcf1dfa02, 0x9bd782f5, 0x3243731b, 0x6486e636, 0xc90dcc6c, 0x97f7ee29, 0x2a03aaa3),
+    CRC_SLICE(0xf20c0dfe, 0xe1f46d0d, 0xc604aceb, 0x89e52f27, 0x162628bf, 0x2c4c517e, 0x5898a2fc, 0xb13145f8),
+};
+
+static const uint64_t crc32c_poly[1] = {0x82f63b78};
+
+static const CRCTable crc32c_table = {
+    .width = 32,
+    .words = 1,
+    .poly = crc32c_poly,
+    .table = crc32c_slices,
+    .slices = crc32c_slices,
+    .fold = {0x740eef02, 0x9e4addf8, 0x1c291d04, 0xddc0152b, 0x3da6d0cb, 0xba4fc28e, 0xf20c0dfe, 0x493c7d27},
+};
+
+// CRC-64 (ECMA-182)
+static const uint64_t crc64_slices[CRC_SLICES * 256] = {
+    CRC_SLICE(0xb32e4cbe03a75f6f, 0xf4843657a840a05b, 0x7bd0c384ff8f5e33, 0xf7a18709ff1ebc66,
+              0x7d9ba13851336649, 0xfb374270a266cc92, 0x64b62bcaebc387a1, 0xc96c5795d7870f42),
+    CRC_SLICE(0x54e979925cd0f10d, 0xa9d2f324b9a1e21a, 0xc17d4962dc4ddab1, 0x10223dee1795abe7,
+              0x20447bdc2f2b57ce, 0x4088f7b85e56af9c, 0x8111ef70bcad5f38, 0x90fb71cad654a0f5),
+    CRC_SLICE(0x3f0be14a916a6dcb, 0x7e17c29522d4db96, 0xfc2f852a45a9b72c, 0x6a87a57f245d70dd,
+              0xd50f4afe48bae1ba, 0x38c63ad73e7bddf1, 0x718c75ae7cf7bbe2, 0xe318eb5cf9ef77c4),
+    CRC_SLICE(0x1dee8a5e222ca1dc, 0x3bdd14bc445943b8, 0x77ba297888b28770, 0xef7452f111650ee0,
+              0x4c300ac98dc40345, 0x986015931b88068a, 0xa218840d981e1391, 0xd6e9a7309f3239a7),
+    CRC_SLICE(0x5c2d776033c4205e, 0xb85aeec0678840bc, 0xe26d72ab601e9ffd, 0x56024a7d6f33217f,
+              0xac0494fade6642fe, 0xcad186de13c29b79, 0x077ba297888b2877, 0x0ef7452f111650ee),
+    CRC_SLICE(0x6184d55f721267c6, 0xc309aabee424cf8c, 0x14cbfa566747819d, 0x2997f4acce8f033a,
+              0x532fe9599d1e0674, 0xa65fd2b33a3c0ce8, 0xde670a4ddb760755, 0x2e16bbb019e2102f),
+    CRC_SLICE(0x22ef0d5934f964ec, 0x45de1ab269f2c9d8, 0x8bbc3564d3e593b0, 0x85a0c5e208c539e5,
+              0x999924efbe846d4f, 0xa1eae6f4d206c41b, 0xd10d62c20b0396b3, 0x30c26aafb90933e3),
+    CRC_SLICE(0xdabe95afc7875f40, 0x27a584742000a005, 0x4f4b08e84001400a, 0x9e9611d080028014,
+              0xaff48c8aaf0b1ead, 0xcd31b63ef11823df, 0x08bbc3564d3e593b, 0x117786ac9a7cb276),
+    CRC_SLICE(0x646c955f440400fe, 0xc8d92abe880801fc, 0x036afa56bf1e1d7d, 0x06d5f4ad7e3c3afa,
+              0x0dabe95afc7875f4, 0x1b57d2b5f8f0ebe8, 0x36afa56bf1e1d7d0, 0x6d5f4ad7e3c3afa0),
+    CRC_SLICE(0x53e7815838846436, 0xa7cf02b07108c86c, 0xdd46aa4b4d1f8e5d, 0x2855fbbd3531023f,
+              0x50abf77a6a62047e, 0xa157eef4d4c408fc, 0xd07772c206860f7d, 0x32364aafa202007f),
+    CRC_SLICE(0x09abf11afca2d0d7, 0x1357e235f945a1ae, 0x26afc46bf28b435c, 0x4d5f88d7e51686b8,
+              0x9abf11afca2d0d70, 0xa7a68c743b540465, 0xdd95b7c3d9a6164f, 0x29f3c0ac1c42321b),
+    CRC_SLICE(0xec32cffb23e3ed7d, 0x4abd30dde8c9c47f, 0x957a61bbd19388fe, 0xb82c6c5c0c290f79,
+              0xe2807793b75c0077, 0x57d8400cc1b61e6b, 0xafb08019836c3cd6, 0xcdb9af18a9d66729),
+    CRC_SLICE(0xdda9f27ee08373ad, 0x298b4bd66e08f9df, 0x531697acdc11f3be, 0xa62d2f59b823e77c,
+              0xde82f198df49d07d, 0x2fdd4c1a119dbe7f, 0x5fba9834233b7cfe, 0xbf7530684676f9fc),
+    CRC_SLICE(0x0dd9b4240837fd99, 0x1bb36848106ffb32, 0x3766d09020dff664, 0x6ecda12041bfecc8,
+              0xdd9b4240837fd990, 0x29ee2baaa9f1ada5, 0x53dc575553e35b4a, 0xa7b8aeaaa7c6b694),
+    CRC_SLICE(0xf075e4ae5e05bdff, 0x723366771305657b, 0xe466ccee260acaf6, 0x5a1536f7e31b8b69,
+              0xb42a6defc63716d2, 0xfa8c74f423603321, 0x67c046c3e9ce78c7, 0xcf808d87d39cf18e),
+    CRC_SLICE(0xe05dd497ca393ae4, 0x526306043b7c6b4d, 0xa4c60c0876f8d69a, 0xdb54b73b42ffb3b1,
+              0x2471c15d2af179e7, 0x48e382ba55e2f3ce, 0x91c70574abc5e79c, 0xb156a5c2f885d1bd),
+};
+
+static const uint64_t crc64_poly[1] = {0xc96c5795d7870f42};
+
+static const CRCTable crc64_table = {
+    .width = 64,
+    .words = 1,
+    .poly = crc64_poly,
+    .table = crc64_slices,
+    .slices = crc64_slices,
+    .fold = {0x6ae3efbb9dd441f3, 0x081f6054a7842df4, 0xb5ea1af9c013aca4, 0x69a35d91c3730254,
+             0x60095b008a9efa44, 0x3be653a30fe1af51, 0xe05dd497ca393ae4, 0xdabe95afc7875f40},
+};
+
+/// The catalog: each model's parameters are as given in the usual crc catalogs, with the polynomial in normal form
+/// (without its leading bit, highest power first) and init and xorout as the register values before reflection
+const CRCModel crc_models[] = {
+    {"crc8", 8, 0x07, 0x00, 0, 0, 0x00, 0xf4, &crc8_table},
+    {"crc16", 16, 0x8005, 0x0000, 1, 1, 0x0000, 0xbb3d, &crc16_table},
+    {"crc16-ccitt", 16, 0x1021, 0xffff, 0, 0, 0x0000, 0x29b1, &crc16_ccitt_table},
+    {"crc32", 32, 0x04c11db7, 0xffffffff, 1, 1, 0xffffffff, 0xcbf43926, &crc32_table},
+    {"crc32c", 32, 0x1edc6f41, 0xffffffff, 1, 1, 0xffffffff, 0xe3069283, &crc32c_table},
+    {"crc64-xz", 64, 0x42f0e1eba9ea3693, 0xffffffffffffffff, 1, 1, 0xffffffffffffffff, 0x995dc9bbdf1939fa,
+     &crc64_table},
+    {"crc64-ecma", 64, 0x42f0e1eba9ea3693, 0x0000000000000000, 0, 0, 0x0000000000000000, 0x6c40df5f0b497347,
+     &crc64_table},
+};
+
+/// Number of models in the catalog
+const size_t crc_model_count = sizeof(crc_models) / sizeof(crc_models[0]);
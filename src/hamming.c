@@ -1,9 +1,13 @@
 #include <hamming.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
 
+// Smallest run of same length messages that goes through the bit-sliced engine, rather than one at a time
+#define HAMMING_BATCH_MIN_LANES 8
+
 /// Given a message length (in bits), msg_len, returns the number of bits required for the hamming encoding of
 /// that message
 size_t hamming_frame_length(size_t message_length) {
@@ -59,10 +63,117 @@ size_t hamming_message_length(size_t frame_length) {
     return m - (h - frame_length);
 }
 
+/// Calculates the syndrome of a frame: the xor of the (1 based) positions of every set bit.
+/// For a valid frame this is 0, otherwise (with a single error) it's the position of the bit in error.
+static size_t hamming_syndrome(const BitStream *stream) {
+    // Masks of the bits in a word whose index has bit j set
+    static const uint64_t index_masks[6] = {
+        0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+        0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull,
+    };
+    size_t nwords, word, syndrome, j;
+    uint64_t bits;
+
+    nwords = BITSTREAM_WORDS(stream->length);
+    syndrome = 0;
+
+    // Work with the stream shifted up by one bit, so bit b of word k is at (1 based) position 64k + b. The last
+    // bit of the stream can be shifted into one extra word past the end
+    for (word = 0; word <= nwords; word++) {
+        bits = word < nwords ? stream->words[word] << 1 : 0;
+        if (word > 0) {
+            bits |= stream->words[word - 1] >> (BITSTREAM_WORD_BITS - 1);
+        }
+
+        // Each set bit contributes 64k, which only survives the xor if there are an odd number of them
+        if (__builtin_parityll(bits)) {
+            syndrome ^= word * BITSTREAM_WORD_BITS;
+        }
+
+        // Bit j of the low 6 bits is the parity of the set bits whose index within the word has bit j set
+        for (j = 0; j < 6; j++) {
+            syndrome ^= (size_t)__builtin_parityll(bits & index_masks[j]) << j;
+        }
+    }
+
+    return syndrome;
+}
+
+/// Finds the k-th run of data bits (k >= 1) in a frame of the given length, returning its length (0 past the end).
+///
+/// In a hamming frame the data bits between parity bits 2^k and 2^(k+1) form one contiguous run, so the whole
+/// message can be moved in O(log n) bit copies instead of one bit at a time.
+static size_t hamming_run(size_t frame_bits, size_t k, size_t *frame_offset, size_t *message_offset) {
+    size_t length;
+
+    // The run starts just after parity bit 2^k (at 0 based index 2^k), after 2^k - k - 1 data bits
+    *frame_offset = (size_t)1 << k;
+    *message_offset = *frame_offset - k - 1;
+
+    if (*frame_offset >= frame_bits) {
+        return 0;
+    }
+
+    // It runs up until the next parity bit, or the end of the frame
+    length = *frame_offset - 1;
+    if (*frame_offset + length > frame_bits) {
+        length = frame_bits - *frame_offset;
+    }
+
+    return length;
+}
+
+/// Encodes input into frame, which must already be the right length and filled with 0
+static void hamming_encode_stream(const BitStream *input, BitStream *frame) {
+    size_t frame_offset, message_offset, length, syndrome, k, i;
+
+    // Copy each run of data bits into place, leaving the parity bits as 0
+    for (k = 1; (length = hamming_run(frame->length, k, &frame_offset, &message_offset)); k++) {
+        bitstream_copy_bits(frame, frame_offset, input, message_offset, length);
+    }
+
+    // With the parity bits all 0 the syndrome is exactly the set of parity bits that need to be 1 to make it 0
+    syndrome = hamming_syndrome(frame);
+    for (i = 1; i <= frame->length; i <<= 1) {
+        if (syndrome & i) {
+            bitstream_set(frame, i - 1, 1);
+        }
+    }
+}
+
+/// Copies the data bits of frame into output, which must already be the right length
+static void hamming_decode_stream(const BitStream *frame, BitStream *output) {
+    size_t frame_offset, message_offset, length, k;
+
+    // Copy each run of data bits out, skipping over the parity bits between them
+    for (k = 1; (length = hamming_run(frame->length, k, &frame_offset, &message_offset)); k++) {
+        bitstream_copy_bits(output, message_offset, frame, frame_offset, length);
+    }
+}
+
+/// Fixes up to one bit of error in frame. Returns 0 if the frame was valid or fixed, or -1 if the syndrome
+/// points outside the frame (so there must have been more than one error)
+static int hamming_fix_stream(BitStream *frame) {
+    size_t error_bit;
+
+    // Each parity bit covers the positions with its bit set, so the parity checks that fail spell out the position
+    // of the error, which is what the syndrome calculates in one pass
+    error_bit = hamming_syndrome(frame);
+
+    // A position past the end of the frame means there was more than one error, which can't be fixed
+    if (error_bit > frame->length) {
+        return -1;
+    }
+
+    if (error_bit) {
+        bitstream_toggle(frame, error_bit - 1);
+    }
+
+    return 0;
+}
+
 /// Encodes the given bitstream into a new hamming frame
 HammingFrame* hamming_encode(BitStream *input) {
-    size_t input_bit, frame_bit, i;
-
     // Create a new frame
     HammingFrame *frame = (HammingFrame*)malloc(sizeof(HammingFrame));
 
@@ -72,31 +183,30 @@ HammingFrame* hamming_encode(BitStream *input) {
 
     // Create the frame bit stream
     frame->frame_stream = bitstream_create(frame->frame_bits);
+    hamming_encode_stream(input, frame->frame_stream);
 
-    // Loop through each bit of the frame, calculating it's value
-    input_bit = 0;
-    for (frame_bit = 0; frame_bit < frame->frame_bits; frame_bit++) {
-        // Loop through all parity bits up until this bit
-        for (i = 1; i < (frame_bit + 1); i = i << 1) {
-            if ((frame_bit + 1) & i) {
-                bitstream_sum(frame->frame_stream, i - 1, bitstream_get(input, input_bit));
-            }
-        }
+    return frame;
+}
 
-        // If i == output_bit + 1 this is a parity bit (and we don't have to do anything)
-        // Otherwise it's a data bit, and we should write it to the output and increment the input_bit counter
-        if (i != frame_bit + 1) {
-            if (bitstream_get(input, input_bit)) {
-                bitstream_set(frame->frame_stream, frame_bit, 1);
-            }
+/// Encodes the given bitstream into a new hamming frame, allocated from an arena
+HammingFrame* hamming_encode_in(Arena *arena, const BitStream *input) {
+    HammingFrame *frame;
 
-            input_bit += 1;
-        }
-    }
+    frame = (HammingFrame*)arena_alloc(arena, sizeof(HammingFrame));
+    frame->message_bits = input->length;
+    frame->frame_bits = hamming_frame_length(input->length);
+    frame->frame_stream = bitstream_create_in(arena, frame->frame_bits);
+    hamming_encode_stream(input, frame->frame_stream);
 
     return frame;
 }
 
+/// Encodes input into frame, a caller owned stream with room for hamming_frame_length(input->length) bits
+void hamming_encode_into(const BitStream *input, BitStream *frame) {
+    bitstream_init(frame, frame->words, hamming_frame_length(input->length));
+    hamming_encode_stream(input, frame);
+}
+
 /// Creates a hamming frame from a bit stream
 HammingFrame* hamming_frame_from_stream(BitStream *stream) {
     // Create a new frame
@@ -115,75 +225,897 @@ HammingFrame* hamming_frame_from_stream(BitStream *stream) {
 /// NOTE! Skips parity bits. User should call hamming_fix_errors first!
 BitStream* hamming_decode(HammingFrame *frame) {
     BitStream *output;
-    size_t output_bit, frame_bit, i;
 
-    // Create the output bitstream, and start writing to bit 0
+    // Create the output bitstream
     output = bitstream_create(frame->message_bits);
-    output_bit = 0;
+    hamming_decode_stream(frame->frame_stream, output);
+
+    return output;
+}
+
+/// Decodes the given hamming frame into a bitstream allocated from an arena
+BitStream* hamming_decode_in(Arena *arena, const HammingFrame *frame) {
+    BitStream *output;
+
+    output = bitstream_create_in(arena, frame->message_bits);
+    hamming_decode_stream(frame->frame_stream, output);
+
+    return output;
+}
+
+/// Decodes the frame stream into output, a caller owned stream with room for hamming_message_length(frame->length)
+/// bits
+void hamming_decode_into(const BitStream *frame, BitStream *output) {
+    bitstream_init(output, output->words, hamming_message_length(frame->length));
+    hamming_decode_stream(frame, output);
+}
+
+/// Given a hamming frame, fixes any error found (up to 1 bit of error)
+void hamming_fix_errors(HammingFrame *frame) {
+    hamming_fix_stream(frame->frame_stream);
+}
+
+/// Returns the (1 based) position in a frame of message bit data_index
+static size_t hamming_data_position(size_t data_index) {
+    size_t k;
+
+    // Run k of data bits starts at message bit 2^k - k - 1 and frame index 2^k (see hamming_run), so find the run
+    // the bit is in, which puts it k + 1 bits further along in the frame than in the message
+    for (k = 1; ((size_t)1 << (k + 1)) - (k + 1) - 1 <= data_index; k++);
+
+    return data_index + k + 2;
+}
+
+/// Toggles the parity bits for each bit set in delta, an xor of the positions of data bits that changed
+static void hamming_apply_delta(BitStream *frame, size_t delta) {
+    size_t i;
+
+    // Parity bit 2^j covers every position with bit j set, so a change at a position flips exactly the parity bits
+    // spelled out by its bits, and the changes from several positions add up with xor
+    for (i = 1; i <= delta; i <<= 1) {
+        if (delta & i) {
+            bitstream_toggle(frame, i - 1);
+        }
+    }
+}
+
+/// Sets message bit data_index of a frame to value, and updates only the parity bits that cover it
+int hamming_set_data_bit(HammingFrame *frame, size_t data_index, unsigned char value) {
+    return hamming_set_data_bits(frame, &data_index, &value, 1);
+}
+
+/// Sets count message bits of a frame, with the parity changes gathered into a single delta
+int hamming_set_data_bits(HammingFrame *frame, const size_t *data_indices, const unsigned char *values, size_t count) {
+    size_t position, delta, i;
+
+    for (i = 0; i < count; i++) {
+        if (data_indices[i] >= frame->message_bits) {
+            return -1;
+        }
+    }
+
+    // Only bits that actually change count towards the delta, like a syndrome of the edit
+    delta = 0;
+    for (i = 0; i < count; i++) {
+        position = hamming_data_position(data_indices[i]);
+        if (bitstream_get(frame->frame_stream, position - 1) != (values[i] & 1)) {
+            bitstream_toggle(frame->frame_stream, position - 1);
+            delta ^= position;
+        }
+    }
+    hamming_apply_delta(frame->frame_stream, delta);
+
+    return 0;
+}
+
+/// Free memory allocated for a hamming frame
+void hamming_destroy(HammingFrame *frame) {
+    bitstream_destroy(frame->frame_stream);
+    free(frame);
+}
+
+/// Transposes a 64x64 bit matrix in place: bit j of a[i] swaps with bit i of a[j]
+static void hamming_transpose64(uint64_t a[64]) {
+    uint64_t mask, t;
+    size_t j, k;
+
+    // Swap the off diagonal 32x32 blocks, then the 16x16 blocks within each of those, and so on down to single bits
+    mask = 0x00000000FFFFFFFFull;
+    for (j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for (k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            t = ((a[k] >> j) ^ a[k | j]) & mask;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+/// Bit-slices `lanes` (up to 64) streams of the same length: bit i of slices[b] is set to bit b of streams[i]
+static void hamming_batch_load(BitStream **streams, size_t lanes, size_t length, uint64_t *slices) {
+    uint64_t block[HAMMING_BATCH_LANES];
+    size_t word, nbits, i;
+
+    for (word = 0; word < BITSTREAM_WORDS(length); word++) {
+        // Lanes past the end of the batch are left as 0, and so are the padding bits past the end of each stream
+        for (i = 0; i < HAMMING_BATCH_LANES; i++) {
+            block[i] = i < lanes ? streams[i]->words[word] : 0;
+        }
+        hamming_transpose64(block);
+
+        nbits = length - word * BITSTREAM_WORD_BITS < 64 ? length - word * BITSTREAM_WORD_BITS : 64;
+        memcpy(slices + word * BITSTREAM_WORD_BITS, block, nbits * sizeof(uint64_t));
+    }
+}
+
+/// Undoes hamming_batch_load, writing bit b of each lane in slices back into bit b of its stream
+static void hamming_batch_store(const uint64_t *slices, size_t length, BitStream **streams, size_t lanes) {
+    uint64_t block[HAMMING_BATCH_LANES];
+    size_t word, nbits, i;
+
+    for (word = 0; word < BITSTREAM_WORDS(length); word++) {
+        // Positions past the end of the streams are 0, which keeps their padding bits 0
+        nbits = length - word * BITSTREAM_WORD_BITS < 64 ? length - word * BITSTREAM_WORD_BITS : 64;
+        memcpy(block, slices + word * BITSTREAM_WORD_BITS, nbits * sizeof(uint64_t));
+        memset(block + nbits, 0, (HAMMING_BATCH_LANES - nbits) * sizeof(uint64_t));
+        hamming_transpose64(block);
+
+        for (i = 0; i < lanes; i++) {
+            streams[i]->words[word] = block[i];
+        }
+    }
+}
+
+/// Encodes `lanes` messages of the same length at once, into frames that are already the right length and filled
+/// with 0. Each slice holds one frame position across every message, so each parity bit is a plain xor of slices
+static void hamming_encode_lanes(BitStream **inputs, BitStream **frames, size_t lanes) {
+    uint64_t *message, *slices, bits;
+    size_t message_bits, frame_bits, position, i;
+
+    message_bits = inputs[0]->length;
+    frame_bits = frames[0]->length;
+    message = (uint64_t*)malloc(message_bits * sizeof(uint64_t));
+    slices = (uint64_t*)calloc(frame_bits, sizeof(uint64_t));
+
+    hamming_batch_load(inputs, lanes, message_bits, message);
+
+    // Lay the data bits out around the parity bits (at the powers of two), adding each one into the parity bits
+    // that cover its (1 based) position
+    i = 0;
+    for (position = 1; position <= frame_bits; position++) {
+        if (!(position & (position - 1))) {
+            continue;
+        }
+
+        slices[position - 1] = message[i++];
+        for (bits = position; bits; bits &= bits - 1) {
+            slices[((size_t)1 << __builtin_ctzll(bits)) - 1] ^= slices[position - 1];
+        }
+    }
+
+    hamming_batch_store(slices, frame_bits, frames, lanes);
+
+    free(slices);
+    free(message);
+}
+
+/// Fixes up to one bit of error in each of `lanes` frames of the same length at once, the same way as
+/// hamming_fix_stream. The syndromes are built bit-sliced, then transposed back to one per frame
+static void hamming_fix_lanes(BitStream **frames, size_t lanes) {
+    uint64_t *slices, syndrome[HAMMING_BATCH_LANES], bits;
+    size_t frame_bits, position, i;
+
+    frame_bits = frames[0]->length;
+    slices = (uint64_t*)malloc(frame_bits * sizeof(uint64_t));
+
+    hamming_batch_load(frames, lanes, frame_bits, slices);
+
+    // Bit j of every syndrome is the parity of the positions with bit j set
+    memset(syndrome, 0, sizeof(syndrome));
+    for (position = 1; position <= frame_bits; position++) {
+        for (bits = position; bits; bits &= bits - 1) {
+            syndrome[__builtin_ctzll(bits)] ^= slices[position - 1];
+        }
+    }
+
+    hamming_transpose64(syndrome);
+    for (i = 0; i < lanes; i++) {
+        if (syndrome[i] && syndrome[i] <= frame_bits) {
+            bitstream_toggle(frames[i], syndrome[i] - 1);
+        }
+    }
+
+    free(slices);
+}
+
+/// Encodes count messages into new hamming frames, giving the same frames as calling hamming_encode on each one.
+/// Runs of messages with the same length are bit-sliced, and encoded HAMMING_BATCH_LANES at a time
+void hamming_encode_batch(BitStream **inputs, HammingFrame **frames, size_t count) {
+    BitStream *streams[HAMMING_BATCH_LANES];
+    size_t done, lanes, i;
+
+    for (done = 0; done < count; done += lanes) {
+        for (lanes = 1; lanes < count - done && lanes < HAMMING_BATCH_LANES; lanes++) {
+            if (inputs[done + lanes]->length != inputs[done]->length) {
+                break;
+            }
+        }
+
+        // Too few messages to be worth transposing (or empty ones) go through one at a time
+        if (lanes < HAMMING_BATCH_MIN_LANES || !inputs[done]->length) {
+            for (i = 0; i < lanes; i++) {
+                frames[done + i] = hamming_encode(inputs[done + i]);
+            }
+            continue;
+        }
+
+        for (i = 0; i < lanes; i++) {
+            frames[done + i] = (HammingFrame*)malloc(sizeof(HammingFrame));
+            frames[done + i]->message_bits = inputs[done + i]->length;
+            frames[done + i]->frame_bits = hamming_frame_length(inputs[done + i]->length);
+            frames[done + i]->frame_stream = bitstream_create(frames[done + i]->frame_bits);
+            streams[i] = frames[done + i]->frame_stream;
+        }
+
+        hamming_encode_lanes(inputs + done, streams, lanes);
+    }
+}
+
+/// Fixes up to one bit of error in each of count frames, like calling hamming_fix_errors on each one
+void hamming_fix_errors_batch(HammingFrame **frames, size_t count) {
+    BitStream *streams[HAMMING_BATCH_LANES];
+    size_t done, lanes, i;
+
+    for (done = 0; done < count; done += lanes) {
+        streams[0] = frames[done]->frame_stream;
+        for (lanes = 1; lanes < count - done && lanes < HAMMING_BATCH_LANES; lanes++) {
+            if (frames[done + lanes]->frame_bits != frames[done]->frame_bits) {
+                break;
+            }
+            streams[lanes] = frames[done + lanes]->frame_stream;
+        }
+
+        if (lanes < HAMMING_BATCH_MIN_LANES || !frames[done]->frame_bits) {
+            for (i = 0; i < lanes; i++) {
+                hamming_fix_errors(frames[done + i]);
+            }
+            continue;
+        }
+
+        hamming_fix_lanes(streams, lanes);
+    }
+}
+
+/// Shape of each block code
+typedef struct {
+    size_t n;               // Bits in each codeword
+    size_t k;               // Message bits in each codeword
+    size_t hamming_bits;    // Bits in the hamming part of the codeword (n without the SECDED parity bit)
+    int secded;             // Whether each codeword ends with an overall parity bit
+} HammingBlockParams;
+
+static const HammingBlockParams hamming_block_params[] = {
+    [HAMMING_BLOCK_7_4] = {7, 4, 7, 0},
+    [HAMMING_BLOCK_15_11] = {15, 11, 15, 0},
+    [HAMMING_BLOCK_31_26] = {31, 26, 31, 0},
+    [HAMMING_BLOCK_72_64] = {72, 64, 71, 1},
+};
+
+// Lookup tables for the small codes: message -> codeword, codeword -> corrected codeword, and codeword -> message
+static uint8_t hamming_block_7_4_encode[1 << 4];
+static uint8_t hamming_block_7_4_correct[1 << 7];
+static uint8_t hamming_block_7_4_extract[1 << 7];
+static uint16_t hamming_block_15_11_encode[1 << 11];
+static uint16_t hamming_block_15_11_correct[1 << 15];
+static uint16_t hamming_block_15_11_extract[1 << 15];
+static pthread_once_t hamming_block_tables_once = PTHREAD_ONCE_INIT;
+
+/// Encodes up to 64 message bits into a codeword of hamming_bits (up to 127) bits, laid out like hamming_encode
+static void hamming_block_encode_word(uint64_t data, size_t k, size_t hamming_bits, uint64_t codeword[2]) {
+    BitStream message, frame;
+
+    // Wrap the words as bitstreams, so the frame can be built the same way as a whole message frame
+    message.words = &data;
+    message.length = k;
+    codeword[0] = 0;
+    codeword[1] = 0;
+    frame.words = codeword;
+    frame.length = hamming_bits;
+
+    hamming_encode_stream(&message, &frame);
+}
+
+/// Fixes up to one bit of error in a codeword of hamming_bits bits. Returns 0 if the codeword was valid or fixed, or
+/// -1 if it had more errors than could be fixed
+static int hamming_block_correct_word(uint64_t codeword[2], size_t hamming_bits, int secded) {
+    BitStream frame;
+    uint64_t parity_mask, parity_bit;
+    size_t syndrome;
+    int parity, result;
 
-    for (frame_bit = 0; frame_bit < frame->frame_bits; frame_bit++) {
-        // printf("processing input bit %d\n", frame_bit);
+    frame.words = codeword;
+    frame.length = hamming_bits;
 
-        // Loop through all powers of 2 up until the frame bit
-        for (i = 1; i < (frame_bit + 1); i = i << 1) {}
+    if (!secded) {
+        return hamming_fix_stream(&frame);
+    }
+
+    // Take the overall parity bit off the end, so the syndrome only sees the hamming part
+    parity_mask = (uint64_t)1 << (hamming_bits % 64);
+    parity_bit = codeword[hamming_bits / 64] & parity_mask;
+    parity = __builtin_parityll(codeword[0]) ^ __builtin_parityll(codeword[1]);
+    codeword[hamming_bits / 64] &= ~parity_mask;
+
+    syndrome = hamming_syndrome(&frame);
+    result = 0;
+
+    if (!parity) {
+        // A single error always flips the overall parity, so if the syndrome isn't 0 there were two errors
+        if (syndrome) {
+            result = -1;
+        }
+    } else if (!syndrome) {
+        // The error was in the overall parity bit itself
+        parity_bit ^= parity_mask;
+    } else if (syndrome <= hamming_bits) {
+        bitstream_toggle(&frame, syndrome - 1);
+    } else {
+        result = -1;
+    }
+
+    codeword[hamming_bits / 64] |= parity_bit;
+
+    return result;
+}
+
+/// Extracts the k message bits from a codeword of hamming_bits bits
+static uint64_t hamming_block_extract_word(uint64_t codeword[2], size_t k, size_t hamming_bits) {
+    BitStream message, frame;
+    uint64_t data;
+
+    data = 0;
+    message.words = &data;
+    message.length = k;
+    frame.words = codeword;
+    frame.length = hamming_bits;
+
+    hamming_decode_stream(&frame, &message);
+
+    return data;
+}
+
+/// Builds the lookup tables for the small codes from the word at a time functions
+static void hamming_block_build_tables() {
+    uint64_t codeword[2];
+    size_t i;
+
+    for (i = 0; i < (1 << 4); i++) {
+        hamming_block_encode_word(i, 4, 7, codeword);
+        hamming_block_7_4_encode[i] = (uint8_t)codeword[0];
+    }
+    for (i = 0; i < (1 << 7); i++) {
+        codeword[0] = i;
+        codeword[1] = 0;
+        hamming_block_7_4_extract[i] = (uint8_t)hamming_block_extract_word(codeword, 4, 7);
+        hamming_block_correct_word(codeword, 7, 0);
+        hamming_block_7_4_correct[i] = (uint8_t)codeword[0];
+    }
+
+    for (i = 0; i < (1 << 11); i++) {
+        hamming_block_encode_word(i, 11, 15, codeword);
+        hamming_block_15_11_encode[i] = (uint16_t)codeword[0];
+    }
+    for (i = 0; i < (1 << 15); i++) {
+        codeword[0] = i;
+        codeword[1] = 0;
+        hamming_block_15_11_extract[i] = (uint16_t)hamming_block_extract_word(codeword, 11, 15);
+        hamming_block_correct_word(codeword, 15, 0);
+        hamming_block_15_11_correct[i] = (uint16_t)codeword[0];
+    }
+}
+
+/// Parses the name of a block code (like "7,4") into code. Returns 0 on success, or -1 if it isn't a known code
+int hamming_block_parse(const char *name, HammingBlockCode *code) {
+    if (!strcmp(name, "7,4")) {
+        *code = HAMMING_BLOCK_7_4;
+    } else if (!strcmp(name, "15,11")) {
+        *code = HAMMING_BLOCK_15_11;
+    } else if (!strcmp(name, "31,26")) {
+        *code = HAMMING_BLOCK_31_26;
+    } else if (!strcmp(name, "72,64")) {
+        *code = HAMMING_BLOCK_72_64;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+/// Returns the number of message bits in each full codeword of a block code
+size_t hamming_block_message_bits(HammingBlockCode code) {
+    return hamming_block_params[code].k;
+}
+
+/// Given a message length, returns the number of bits in its block encoding. Full blocks of k bits become n bit
+/// codewords, and any bits left over are encoded as one shorter hamming frame (plus a parity bit for SECDED)
+size_t hamming_block_frame_length(size_t message_length, HammingBlockCode code) {
+    const HammingBlockParams *params;
+    size_t tail;
+
+    params = &hamming_block_params[code];
+    tail = message_length % params->k;
+
+    return (message_length / params->k) * params->n + (tail ? hamming_frame_length(tail) + params->secded : 0);
+}
+
+/// Given the length of a block encoding, returns the number of message bits, or HAMMING_BLOCK_INVALID if no message
+/// encodes to that length
+size_t hamming_block_message_length(size_t frame_length, HammingBlockCode code) {
+    const HammingBlockParams *params;
+    size_t tail, tail_message;
+
+    params = &hamming_block_params[code];
+    tail = frame_length % params->n;
+
+    if (!tail) {
+        return (frame_length / params->n) * params->k;
+    }
+
+    // The shorter frame at the end has to be a valid hamming frame length on its own
+    if (tail < 3 + (size_t)params->secded) {
+        return HAMMING_BLOCK_INVALID;
+    }
+    tail -= params->secded;
+    tail_message = hamming_message_length(tail);
+    if (hamming_frame_length(tail_message) != tail) {
+        return HAMMING_BLOCK_INVALID;
+    }
+
+    return (frame_length / params->n) * params->k + tail_message;
+}
 
-        // If i == frame_bit + 1 this is a parity bit, otherwise it's a data bit.
-        if (i != frame_bit + 1) {
-            bitstream_set(output, output_bit, bitstream_get(frame->frame_stream, frame_bit));
-            output_bit++;
+/// Encodes the given bitstream into a new frame of fixed size codewords
+HammingFrame* hamming_block_encode(const BitStream *input, HammingBlockCode code) {
+    HammingFrame *frame;
+
+    // Create a new frame
+    frame = (HammingFrame*)malloc(sizeof(HammingFrame));
+    frame->message_bits = input->length;
+    frame->frame_bits = hamming_block_frame_length(input->length, code);
+    frame->frame_stream = bitstream_create(frame->frame_bits);
+
+    hamming_block_encode_into(input, frame->frame_stream, code);
+
+    return frame;
+}
+
+/// Encodes input into frame, a caller owned stream with room for hamming_block_frame_length(input->length) bits
+void hamming_block_encode_into(const BitStream *input, BitStream *frame, HammingBlockCode code) {
+    const HammingBlockParams *params;
+    uint64_t codeword[2], data;
+    size_t message_offset, frame_offset, k, hamming_bits;
+
+    pthread_once(&hamming_block_tables_once, hamming_block_build_tables);
+    params = &hamming_block_params[code];
+
+    bitstream_init(frame, frame->words, hamming_block_frame_length(input->length, code));
+
+    frame_offset = 0;
+    for (message_offset = 0; message_offset < input->length; message_offset += k) {
+        // Every block is full apart from (maybe) the last one
+        k = input->length - message_offset < params->k ? input->length - message_offset : params->k;
+        hamming_bits = k == params->k ? params->hamming_bits : hamming_frame_length(k);
+        data = bitstream_read_bits(input, message_offset, k);
+
+        if (code == HAMMING_BLOCK_7_4 && k == params->k) {
+            codeword[0] = hamming_block_7_4_encode[data];
+            codeword[1] = 0;
+        } else if (code == HAMMING_BLOCK_15_11 && k == params->k) {
+            codeword[0] = hamming_block_15_11_encode[data];
+            codeword[1] = 0;
+        } else {
+            hamming_block_encode_word(data, k, hamming_bits, codeword);
+        }
+
+        // SECDED codewords end with the parity of the rest of the codeword
+        if (params->secded) {
+            codeword[hamming_bits / 64] |= (uint64_t)(__builtin_parityll(codeword[0]) ^ __builtin_parityll(codeword[1]))
+                                           << (hamming_bits % 64);
+            hamming_bits += 1;
         }
 
-        //printf("Output: %d\n", output[0]);
+        bitstream_write_bits(frame, frame_offset, codeword[0], hamming_bits < 64 ? hamming_bits : 64);
+        if (hamming_bits > 64) {
+            bitstream_write_bits(frame, frame_offset + 64, codeword[1], hamming_bits - 64);
+        }
+        frame_offset += hamming_bits;
     }
+}
+
+/// Creates a block frame from a bit stream, or returns NULL if the stream isn't a valid length for the code
+HammingFrame* hamming_block_frame_from_stream(BitStream *stream, HammingBlockCode code) {
+    HammingFrame *frame;
+    size_t message_bits;
+
+    message_bits = hamming_block_message_length(stream->length, code);
+    if (message_bits == HAMMING_BLOCK_INVALID) {
+        return NULL;
+    }
+
+    frame = (HammingFrame*)malloc(sizeof(HammingFrame));
+    frame->frame_bits = stream->length;
+    frame->message_bits = message_bits;
+    frame->frame_stream = stream;
+
+    return frame;
+}
+
+/// Reads the codeword for the message bits at message_offset, from a block frame of message_bits message bits.
+/// Returns the number of bits in the codeword, and sets k and hamming_bits to the number of message and hamming bits
+/// in it
+static size_t hamming_block_read_codeword(const BitStream *stream, size_t message_bits,
+                                          const HammingBlockParams *params, size_t message_offset,
+                                          size_t frame_offset, uint64_t codeword[2], size_t *k, size_t *hamming_bits) {
+    size_t n;
+
+    *k = message_bits - message_offset < params->k ? message_bits - message_offset : params->k;
+    *hamming_bits = *k == params->k ? params->hamming_bits : hamming_frame_length(*k);
+    n = *hamming_bits + params->secded;
+
+    codeword[0] = bitstream_read_bits(stream, frame_offset, n < 64 ? n : 64);
+    codeword[1] = n > 64 ? bitstream_read_bits(stream, frame_offset + 64, n - 64) : 0;
+
+    return n;
+}
+
+/// Fixes up to one bit of error in each codeword of a block frame (or, for SECDED, detects two bit errors).
+/// Returns the number of codewords with errors that couldn't be fixed
+size_t hamming_block_fix_errors(HammingFrame *frame, HammingBlockCode code) {
+    const HammingBlockParams *params;
+    uint64_t codeword[2];
+    size_t message_offset, frame_offset, k, hamming_bits, n, uncorrectable;
+
+    pthread_once(&hamming_block_tables_once, hamming_block_build_tables);
+    params = &hamming_block_params[code];
+
+    uncorrectable = 0;
+    frame_offset = 0;
+    for (message_offset = 0; message_offset < frame->message_bits; message_offset += k) {
+        n = hamming_block_read_codeword(frame->frame_stream, frame->message_bits, params, message_offset, frame_offset,
+                                        codeword, &k, &hamming_bits);
+
+        if (code == HAMMING_BLOCK_7_4 && k == params->k) {
+            codeword[0] = hamming_block_7_4_correct[codeword[0]];
+        } else if (code == HAMMING_BLOCK_15_11 && k == params->k) {
+            codeword[0] = hamming_block_15_11_correct[codeword[0]];
+        } else if (hamming_block_correct_word(codeword, hamming_bits, params->secded) < 0) {
+            uncorrectable++;
+        }
+
+        bitstream_write_bits(frame->frame_stream, frame_offset, codeword[0], n < 64 ? n : 64);
+        if (n > 64) {
+            bitstream_write_bits(frame->frame_stream, frame_offset + 64, codeword[1], n - 64);
+        }
+
+        frame_offset += n;
+    }
+
+    return uncorrectable;
+}
+
+/// Decodes the given block frame into a bitstream
+/// NOTE! Skips parity bits. User should call hamming_block_fix_errors first!
+BitStream* hamming_block_decode(HammingFrame *frame, HammingBlockCode code) {
+    BitStream *output;
+
+    output = bitstream_create(frame->message_bits);
+    hamming_block_decode_into(frame->frame_stream, output, code);
 
     return output;
 }
 
-/// Given a hamming frame, fixes any error found (up to 1 bit of error)
-void hamming_fix_errors(HammingFrame *frame) {
-    size_t frame_bit, i, error_bit, parity;
+/// Decodes a block frame stream (which must be a valid length for the code) into output, a caller owned stream with
+/// room for hamming_block_message_length(frame->length) bits
+void hamming_block_decode_into(const BitStream *frame, BitStream *output, HammingBlockCode code) {
+    const HammingBlockParams *params;
+    uint64_t codeword[2], data;
+    size_t message_bits, message_offset, frame_offset, k, hamming_bits;
+
+    pthread_once(&hamming_block_tables_once, hamming_block_build_tables);
+    params = &hamming_block_params[code];
+
+    message_bits = hamming_block_message_length(frame->length, code);
+    bitstream_init(output, output->words, message_bits);
+
+    frame_offset = 0;
+    for (message_offset = 0; message_offset < message_bits; message_offset += k) {
+        frame_offset += hamming_block_read_codeword(frame, message_bits, params, message_offset, frame_offset, codeword,
+                                                    &k, &hamming_bits);
+
+        if (code == HAMMING_BLOCK_7_4 && k == params->k) {
+            data = hamming_block_7_4_extract[codeword[0]];
+        } else if (code == HAMMING_BLOCK_15_11 && k == params->k) {
+            data = hamming_block_15_11_extract[codeword[0]];
+        } else {
+            data = hamming_block_extract_word(codeword, k, hamming_bits);
+        }
+
+        bitstream_write_bits(output, message_offset, data, k);
+    }
+}
+
+/// Encodes random messages, flips a random bit in each frame, and checks that the error is fixed
+static void hamming_test_random_errors() {
+    BitStream *input, *received, *output;
+    HammingFrame *frame, *received_frame;
+    size_t length, i;
+
+    srand(4220);
+
+    for (length = 1; length <= 600; length += 7) {
+        input = bitstream_create(length);
+        for (i = 0; i < length; i++) {
+            bitstream_set(input, i, rand() & 1);
+        }
 
-    error_bit = 0;
+        frame = hamming_encode(input);
 
-    for (frame_bit = 0; frame_bit < frame->frame_bits; frame_bit++) {
-        // printf("processing input bit %d/%d (= %d)\n", frame_bit + 1, frame->frame_bits, bitstream_get(frame->frame_stream, frame_bit));
+        // A frame without errors shouldn't be changed
+        received = bitstream_copy(frame->frame_stream, frame->frame_bits);
+        received_frame = hamming_frame_from_stream(received);
+        hamming_fix_errors(received_frame);
+        assert(!bitstream_lt(received, frame->frame_stream) && !bitstream_lt(frame->frame_stream, received));
+        hamming_destroy(received_frame);
 
-        // Loop through all powers of 2 up until the frame bit
-        for (i = 1; i < (frame_bit + 1); i = i << 1) {}
+        // A single flipped bit anywhere in the frame should be fixed
+        received = bitstream_copy(frame->frame_stream, frame->frame_bits);
+        bitstream_toggle(received, rand() % frame->frame_bits);
+        received_frame = hamming_frame_from_stream(received);
+        hamming_fix_errors(received_frame);
+        assert(!bitstream_lt(received, frame->frame_stream) && !bitstream_lt(frame->frame_stream, received));
 
-        // If i == frame_bit + 1 this is a parity bit, otherwise it's a data bit.
-        if (i == frame_bit + 1) {
-            // Parity bit - check for error
-            parity = 0;
-            for (i = 0; i < frame->frame_bits + 1; i++) {
-                if (!(i & (frame_bit + 1))) {
-                    continue;
+        output = hamming_decode(received_frame);
+        assert(!bitstream_lt(output, input) && !bitstream_lt(input, output));
+
+        bitstream_destroy(output);
+        hamming_destroy(received_frame);
+        hamming_destroy(frame);
+        bitstream_destroy(input);
+    }
+}
+
+/// Checks that two bitstreams hold the same bits
+static int hamming_test_equal(const BitStream *lhs, const BitStream *rhs) {
+    return lhs->length == rhs->length && !bitstream_lt(lhs, rhs) && !bitstream_lt(rhs, lhs);
+}
+
+/// Sets message bits of encoded frames one at a time and in batches, and checks they match encoding the edited
+/// message from scratch
+static void hamming_test_set_data_bits() {
+    BitStream *input;
+    HammingFrame *frame, *expected;
+    size_t indices[32], length, round, count, i;
+    unsigned char values[32];
+    int result;
+
+    for (length = 1; length <= 600; length += 13) {
+        input = bitstream_create(length);
+        for (i = 0; i < length; i++) {
+            bitstream_set(input, i, rand() & 1);
+        }
+        frame = hamming_encode(input);
+
+        for (round = 0; round < 8; round++) {
+            // Odd rounds set one bit at a time, even rounds a batch (where an index can repeat, and the last wins)
+            count = 1 + rand() % 32;
+            for (i = 0; i < count; i++) {
+                indices[i] = i && rand() % 4 == 0 ? indices[i - 1] : rand() % length;
+                values[i] = rand() & 1;
+                bitstream_set(input, indices[i], values[i]);
+                if (round % 2) {
+                    result = hamming_set_data_bit(frame, indices[i], values[i]);
+                    assert(result == 0);
                 }
-                parity ^= bitstream_get(frame->frame_stream, i - 1);
-                // printf("Checking %d (%d => %d)\n", i, bitstream_get(frame->frame_stream, i - 1), parity);
+            }
+            if (!(round % 2)) {
+                result = hamming_set_data_bits(frame, indices, values, count);
+                assert(result == 0);
             }
 
-            if (parity) {
-                // Parity was not 0, so there is an error with this parity bit
-                error_bit += frame_bit + 1;
-                // printf("Parity error on bit %d!\n", frame_bit + 1);
+            expected = hamming_encode(input);
+            assert(hamming_test_equal(frame->frame_stream, expected->frame_stream));
+            hamming_destroy(expected);
+        }
+
+        // Indices past the message are rejected without changing anything
+        indices[0] = 0;
+        indices[1] = length;
+        values[0] = !bitstream_get(input, 0);
+        values[1] = 1;
+        result = hamming_set_data_bit(frame, length, 1);
+        assert(result == -1);
+        result = hamming_set_data_bits(frame, indices, values, 2);
+        assert(result == -1);
+        expected = hamming_encode(input);
+        assert(hamming_test_equal(frame->frame_stream, expected->frame_stream));
+        hamming_destroy(expected);
+
+        hamming_destroy(frame);
+        bitstream_destroy(input);
+    }
+}
+
+/// Encodes runs of messages with different lengths in batches, and checks they match encoding them one at a time
+static void hamming_test_batch() {
+    BitStream *inputs[300];
+    HammingFrame *frames[300], *expected[300];
+    size_t count, length, i, j;
+
+    // Runs of every size, so some are split into several batches and some are too short to batch at all
+    count = 0;
+    for (length = 1; count < 300; length += 29) {
+        for (i = 0; i < 1 + length % 131 && count < 300; i++) {
+            inputs[count] = bitstream_create(length);
+            for (j = 0; j < length; j++) {
+                bitstream_set(inputs[count], j, rand() & 1);
             }
+            count++;
         }
+    }
 
-        //printf("Output: %d\n", output[0]);
+    hamming_encode_batch(inputs, frames, count);
+    for (i = 0; i < count; i++) {
+        expected[i] = hamming_encode(inputs[i]);
+        assert(frames[i]->message_bits == expected[i]->message_bits);
+        assert(frames[i]->frame_bits == expected[i]->frame_bits);
+        assert(hamming_test_equal(frames[i]->frame_stream, expected[i]->frame_stream));
     }
 
-    if (error_bit) {
-        //printf("Detected error on bit %d...\n", error_bit);
+    // Flip one bit in most frames (and two in some, which may move the "fix" out of the frame), then fix them
+    // both ways
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < i % 3; j++) {
+            length = rand() % frames[i]->frame_bits;
+            bitstream_toggle(frames[i]->frame_stream, length);
+            bitstream_toggle(expected[i]->frame_stream, length);
+        }
+    }
+
+    hamming_fix_errors_batch(frames, count);
+    for (i = 0; i < count; i++) {
+        hamming_fix_errors(expected[i]);
+        assert(hamming_test_equal(frames[i]->frame_stream, expected[i]->frame_stream));
 
-        bitstream_toggle(frame->frame_stream, error_bit - 1);
+        hamming_destroy(expected[i]);
+        hamming_destroy(frames[i]);
+        bitstream_destroy(inputs[i]);
     }
 }
 
-/// Free memory allocated for a hamming frame
-void hamming_destroy(HammingFrame *frame) {
-    bitstream_destroy(frame->frame_stream);
-    free(frame);
+/// Encodes random messages with each block code, and checks errors in every codeword are fixed (or detected)
+static void hamming_test_blocks() {
+    static const HammingBlockCode codes[] = {
+        HAMMING_BLOCK_7_4, HAMMING_BLOCK_15_11, HAMMING_BLOCK_31_26, HAMMING_BLOCK_72_64,
+    };
+    static const size_t n[] = {7, 15, 31, 72};
+    static const size_t k[] = {4, 11, 26, 64};
+    BitStream *input, *block, *received, *output;
+    HammingFrame *frame, *expected, *received_frame;
+    HammingBlockCode code;
+    size_t c, length, i, codeword, uncorrectable;
+
+    for (c = 0; c < 4; c++) {
+        code = codes[c];
+
+        // Lengths should map back and forth, including the shorter frame at the end
+        for (length = 0; length <= 300; length++) {
+            assert(hamming_block_message_length(hamming_block_frame_length(length, code), code) == length);
+        }
+        assert(hamming_block_message_length(n[c] + 1, code) == HAMMING_BLOCK_INVALID);
+
+        for (length = 1; length <= 700; length += 37) {
+            input = bitstream_create(length);
+            for (i = 0; i < length; i++) {
+                bitstream_set(input, i, rand() & 1);
+            }
+
+            frame = hamming_block_encode(input, code);
+            assert(frame->frame_bits == hamming_block_frame_length(length, code));
+
+            // Each full codeword should be the same as encoding its block on its own (plus the SECDED parity bit)
+            for (codeword = 0; (codeword + 1) * k[c] <= length; codeword++) {
+                block = bitstream_extract(input, codeword * k[c], k[c]);
+                expected = hamming_encode(block);
+                for (i = 0; i < expected->frame_bits; i++) {
+                    assert(bitstream_get(frame->frame_stream, codeword * n[c] + i) ==
+                           bitstream_get(expected->frame_stream, i));
+                }
+                hamming_destroy(expected);
+                bitstream_destroy(block);
+            }
+
+            // Flip one bit in every codeword, which should all get fixed
+            received = bitstream_copy(frame->frame_stream, frame->frame_bits);
+            for (i = 0; i < received->length; i += n[c]) {
+                bitstream_toggle(received, i + rand() % (received->length - i < n[c] ? received->length - i : n[c]));
+            }
+            received_frame = hamming_block_frame_from_stream(received, code);
+            assert(received_frame && received_frame->message_bits == length);
+            uncorrectable = hamming_block_fix_errors(received_frame, code);
+            assert(uncorrectable == 0);
+            assert(hamming_test_equal(received, frame->frame_stream));
+
+            output = hamming_block_decode(received_frame, code);
+            assert(hamming_test_equal(output, input));
+            bitstream_destroy(output);
+
+            // SECDED should notice two flipped bits in a codeword, rather than "fixing" it
+            if (code == HAMMING_BLOCK_72_64 && length >= 64) {
+                bitstream_toggle(received, 3);
+                bitstream_toggle(received, 70);
+                uncorrectable = hamming_block_fix_errors(received_frame, code);
+                assert(uncorrectable == 1);
+            }
+
+            hamming_destroy(received_frame);
+            hamming_destroy(frame);
+            bitstream_destroy(input);
+        }
+    }
+}
+
+/// Encodes and decodes messages of many lengths into the same reused buffers (and an arena), and checks they match
+/// the allocating functions
+static void hamming_test_into() {
+    BitStream *input, *output, frame, message;
+    HammingFrame *expected, *arena_frame;
+    Arena *arena;
+    uint64_t frame_words[BITSTREAM_WORDS(1600)], message_words[BITSTREAM_WORDS(800)];
+    HammingBlockCode code;
+    size_t length, i;
+
+    frame.words = frame_words;
+    message.words = message_words;
+    arena = arena_create(1024);
+
+    for (length = 1; length <= 800; length += 13) {
+        input = bitstream_create(length);
+        for (i = 0; i < length; i++) {
+            bitstream_set(input, i, rand() & 1);
+        }
+
+        expected = hamming_encode(input);
+        hamming_encode_into(input, &frame);
+        assert(hamming_test_equal(&frame, expected->frame_stream));
+        hamming_destroy(expected);
+
+        hamming_decode_into(&frame, &message);
+        assert(hamming_test_equal(&message, input));
+
+        arena_frame = hamming_encode_in(arena, input);
+        assert(hamming_test_equal(arena_frame->frame_stream, &frame));
+        assert(hamming_test_equal(hamming_decode_in(arena, arena_frame), input));
+        if (length % 5 == 0) {
+            arena_reset(arena);
+        }
+
+        for (code = HAMMING_BLOCK_7_4; code <= HAMMING_BLOCK_72_64; code++) {
+            expected = hamming_block_encode(input, code);
+            hamming_block_encode_into(input, &frame, code);
+            assert(hamming_test_equal(&frame, expected->frame_stream));
+
+            output = hamming_block_decode(expected, code);
+            hamming_block_decode_into(&frame, &message, code);
+            assert(hamming_test_equal(&message, output));
+            assert(hamming_test_equal(&message, input));
+
+            bitstream_destroy(output);
+            hamming_destroy(expected);
+        }
+
+        bitstream_destroy(input);
+    }
+
+    arena_destroy(arena);
 }
 
 void hamming_test() {
@@ -270,5 +1202,11 @@ void hamming_test() {
     bitstream_destroy(output_stream);
     hamming_destroy(frame);
 
+    hamming_test_random_errors();
+    hamming_test_blocks();
+    hamming_test_batch();
+    hamming_test_into();
+    hamming_test_set_data_bits();
+
     printf("    => Hamming tests passed!\n");
 }
@@ -18,6 +18,14 @@ size_t hamming_message_length(size_t frame_length);
 /// Encodes the given bitstream into a new hamming frame
 HammingFrame* hamming_encode(BitStream *input);
 
+/// Encodes the given bitstream into a new hamming frame, allocated from an arena (freed by arena_reset, not
+/// hamming_destroy)
+HammingFrame* hamming_encode_in(Arena *arena, const BitStream *input);
+
+/// Encodes input into frame, a caller owned stream with room for hamming_frame_length(input->length) bits.
+/// Sets the length of frame, and doesn't allocate any memory (frame must not be input)
+void hamming_encode_into(const BitStream *input, BitStream *frame);
+
 /// Creates a hamming frame from a bit stream
 HammingFrame* hamming_frame_from_stream(BitStream *stream);
 
@@ -25,9 +33,82 @@ HammingFrame* hamming_frame_from_stream(BitStream *stream);
 /// NOTE! Skips parity bits. User should call hamming_fix_errors first!
 BitStream* hamming_decode(HammingFrame *frame);
 
+/// Decodes the given hamming frame into a bitstream allocated from an arena
+/// NOTE! Skips parity bits. User should call hamming_fix_errors first!
+BitStream* hamming_decode_in(Arena *arena, const HammingFrame *frame);
+
+/// Decodes the frame stream into output, a caller owned stream with room for hamming_message_length(frame->length)
+/// bits. Sets the length of output, and doesn't allocate any memory
+void hamming_decode_into(const BitStream *frame, BitStream *output);
+
 /// Given a hamming frame, fixes any error found (up to 1 bit of error)
 void hamming_fix_errors(HammingFrame *frame);
 
+/// Sets message bit data_index of a frame (not a block frame) to value, and updates only the parity bits that cover
+/// it, in O(log n). Returns 0 on success, or -1 if data_index is past the end of the message
+int hamming_set_data_bit(HammingFrame *frame, size_t data_index, unsigned char value);
+
+/// Sets count message bits of a frame, like calling hamming_set_data_bit for each one in order, but gathers the
+/// parity changes into a single delta that's applied once at the end. Returns 0 on success, or -1 (leaving the frame
+/// unchanged) if any index is past the end of the message
+int hamming_set_data_bits(HammingFrame *frame, const size_t *data_indices, const unsigned char *values, size_t count);
+
+/// Number of messages the batch functions process together, one per bit of a word
+#define HAMMING_BATCH_LANES 64
+
+/// Encodes count messages into new hamming frames, giving the same frames as calling hamming_encode on each one.
+/// Runs of messages with the same length are bit-sliced, and encoded HAMMING_BATCH_LANES at a time
+void hamming_encode_batch(BitStream **inputs, HammingFrame **frames, size_t count);
+
+/// Fixes up to one bit of error in each of count frames, like calling hamming_fix_errors on each one
+void hamming_fix_errors_batch(HammingFrame **frames, size_t count);
+
+/// Fixed size block codes, which split a message into codewords of n bits carrying k message bits each
+typedef enum {
+    HAMMING_BLOCK_7_4,
+    HAMMING_BLOCK_15_11,
+    HAMMING_BLOCK_31_26,
+    HAMMING_BLOCK_72_64,    // (71,64) hamming plus an overall parity bit: single error correction, double detection
+} HammingBlockCode;
+
+/// Returned by hamming_block_message_length for frame lengths no message encodes to
+#define HAMMING_BLOCK_INVALID ((size_t)-1)
+
+/// Parses the name of a block code (like "7,4") into code. Returns 0 on success, or -1 if it isn't a known code
+int hamming_block_parse(const char *name, HammingBlockCode *code);
+
+/// Returns the number of message bits in each full codeword of a block code
+size_t hamming_block_message_bits(HammingBlockCode code);
+
+/// Given a message length, returns the number of bits in its block encoding. Full blocks of k bits become n bit
+/// codewords, and any bits left over are encoded as one shorter hamming frame (plus a parity bit for SECDED)
+size_t hamming_block_frame_length(size_t message_length, HammingBlockCode code);
+
+/// Given the length of a block encoding, returns the number of message bits, or HAMMING_BLOCK_INVALID if no message
+/// encodes to that length
+size_t hamming_block_message_length(size_t frame_length, HammingBlockCode code);
+
+/// Encodes the given bitstream into a new frame of fixed size codewords
+HammingFrame* hamming_block_encode(const BitStream *input, HammingBlockCode code);
+
+/// Encodes input into frame, a caller owned stream with room for hamming_block_frame_length(input->length) bits
+void hamming_block_encode_into(const BitStream *input, BitStream *frame, HammingBlockCode code);
+
+/// Creates a block frame from a bit stream, or returns NULL if the stream isn't a valid length for the code
+HammingFrame* hamming_block_frame_from_stream(BitStream *stream, HammingBlockCode code);
+
+/// Fixes up to one bit of error in each codeword of a block frame (or, for SECDED, detects two bit errors).
+/// Returns the number of codewords with errors that couldn't be fixed
+size_t hamming_block_fix_errors(HammingFrame *frame, HammingBlockCode code);
+
+/// Decodes the given block frame into a bitstream
+/// NOTE! Skips parity bits. User should call hamming_block_fix_errors first!
+BitStream* hamming_block_decode(HammingFrame *frame, HammingBlockCode code);
+
+/// Decodes a block frame stream (which must be a valid length for the code) into output, a caller owned stream with
+/// room for hamming_block_message_length(frame->length) bits
+void hamming_block_decode_into(const BitStream *frame, BitStream *output, HammingBlockCode code);
+
 /// Free memory allocated for a hamming frame
 void hamming_destroy(HammingFrame *frame);
 
@@ -1,13 +1,69 @@
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <arena.h>
+#include <bitio.h>
 #include <bitstream.h>
 #include <crc.h>
 #include <hamming.h>
+#include <mapfile.h>
+#include <pipeline.h>
+#include <stats.h>
+
+// Size of the stdio buffers used in batch mode, so lines are read and written in large blocks
+#define BATCH_IO_BUFFER (1 << 20)
+
+// Number of message bits stream mode reads at a time, unless --chunk-bits says otherwise
+#define STREAM_CHUNK_BITS (1 << 20)
+
+// Number of crc tables batch mode keeps for per-line generators
+#define BATCH_TABLE_CACHE 16
+
+/// Where the data for a run comes from and goes to, when it isn't just --input and stdout
+typedef struct {
+    DataFormat in_format, out_format;
+    char *input_file, *output_file;     // NULL for --input and stdout
+    size_t input_bits;                  // Number of bits to use from the input, or SIZE_MAX for all of it
+} DataOptions;
+
+/// State kept between the lines of a batch, so nothing needs allocating once the buffers are big enough
+typedef struct {
+    BitStream input, output;
+    size_t input_capacity, output_capacity;     // Words allocated for input and output
+    char *string;                               // The output line
+    size_t string_capacity;
+    char *generators[BATCH_TABLE_CACHE];        // Generators of the cached crc tables, as strings
+    CRCTable *tables[BATCH_TABLE_CACHE];
+    size_t next_table;                          // Cache entry to replace next
+} Batch;
+
+/// Reads a string of 0s and 1s into a new bitstream, exiting with an error if it contains anything else
+BitStream *read_bitstream(char *str, char *name) {
+    BitStream *stream;
+    StatsMark mark;
+    size_t length;
+
+    STATS_MARK(mark);
+    length = strlen(str);
+    stream = bitstream_create(length);
+    if (bitstream_read_from_string(stream, str) < 0) {
+        fprintf(stderr, "Invalid %s: %s (must only contain 0 and 1)\n", name, str);
+        exit(1);
+    }
+    STATS_RECORD(STATS_PARSE, mark, length);
+
+    return stream;
+}
 
 /// Entry point for part 1.1
-void part_1_1(char *input_str, int quiet) {
+void part_1_1(char *input_str, HammingBlockCode *block, int quiet) {
     BitStream *input;
     HammingFrame *frame;
+    StatsMark mark;
     char *output;
 
     if (!quiet) {
@@ -15,17 +71,28 @@ void part_1_1(char *input_str, int quiet) {
         printf("Input: %s\n", input_str);
     }
     
-    input = bitstream_create(strlen(input_str));
-    bitstream_read_from_string(input, input_str);
-    frame = hamming_encode(input);
+    input = read_bitstream(input_str, "input");
+    STATS_MARK(mark);
+    if (block) {
+        frame = hamming_block_encode(input, *block);
+    } else {
+        frame = hamming_encode(input);
+    }
+    STATS_RECORD(STATS_HAMMING_ENCODE, mark, BITSTREAM_BYTES(input->length));
+
+    STATS_MARK(mark);
     output = (char*)malloc(frame->frame_stream->length + 1);
     bitstream_write_to_string(frame->frame_stream, output);
+    STATS_RECORD(STATS_FORMAT, mark, frame->frame_stream->length);
 
+    STATS_MARK(mark);
     if (quiet) {
         printf("%s\n", output);
     } else {
         printf("Output: %s\n", output);
     }
+    fflush(stdout);
+    STATS_RECORD(STATS_OUTPUT, mark, frame->frame_stream->length + 1);
 
     free(output);
     hamming_destroy(frame);
@@ -33,9 +100,11 @@ void part_1_1(char *input_str, int quiet) {
 }
 
 /// Entry point for part 1.2
-void part_1_2(char *input_str, int quiet) {
+void part_1_2(char *input_str, HammingBlockCode *block, int quiet) {
     BitStream *input, *output;
     HammingFrame *frame;
+    StatsMark mark;
+    size_t uncorrectable;
     char *output_str;
 
     if (!quiet) {
@@ -43,29 +112,67 @@ void part_1_2(char *input_str, int quiet) {
         printf("Input: %s\n", input_str);
     }
     
-    input = bitstream_create(strlen(input_str));
-    bitstream_read_from_string(input, input_str);
-    frame = hamming_frame_from_stream(input);
-    hamming_fix_errors(frame);
-    output = hamming_decode(frame);
+    input = read_bitstream(input_str, "input");
+    if (block) {
+        frame = hamming_block_frame_from_stream(input, *block);
+        if (!frame) {
+            fprintf(stderr, "Invalid input: %zu bits is not a valid length for the block code\n", input->length);
+            exit(1);
+        }
+
+        // SECDED can detect errors it can't fix, so let the user know
+        STATS_MARK(mark);
+        uncorrectable = hamming_block_fix_errors(frame, *block);
+        STATS_RECORD(STATS_HAMMING_FIX, mark, BITSTREAM_BYTES(frame->frame_bits));
+        if (uncorrectable) {
+            fprintf(stderr, "Warning: %zu codewords had errors that could not be fixed\n", uncorrectable);
+        }
+        STATS_MARK(mark);
+        output = hamming_block_decode(frame, *block);
+        STATS_RECORD(STATS_HAMMING_DECODE, mark, BITSTREAM_BYTES(frame->frame_bits));
+    } else {
+        frame = hamming_frame_from_stream(input);
+        STATS_MARK(mark);
+        hamming_fix_errors(frame);
+        STATS_RECORD(STATS_HAMMING_FIX, mark, BITSTREAM_BYTES(frame->frame_bits));
+        STATS_MARK(mark);
+        output = hamming_decode(frame);
+        STATS_RECORD(STATS_HAMMING_DECODE, mark, BITSTREAM_BYTES(frame->frame_bits));
+    }
+
+    STATS_MARK(mark);
     output_str = (char*)malloc(output->length + 1);
     bitstream_write_to_string(output, output_str);
+    STATS_RECORD(STATS_FORMAT, mark, output->length);
 
+    STATS_MARK(mark);
     if (quiet) {
         printf("%s\n", output_str);
     } else {
         printf("Output: %s\n", output_str);
     }
+    fflush(stdout);
+    STATS_RECORD(STATS_OUTPUT, mark, output->length + 1);
 
     free(output_str);
     bitstream_destroy(output);
     hamming_destroy(frame);
 }
 
-/// Entry point for part 2
-void part_2(char *input_str, char *generator_str, int quiet) {
+/// Exits with an error if a message can't be used with a crc model
+void check_model_input(const CRCModel *model, size_t nbits) {
+    if (nbits % 8) {
+        fprintf(stderr, "Invalid input: %s works on whole bytes, but the input is %zu bits\n", model->name, nbits);
+        exit(1);
+    }
+}
+
+/// Entry point for part 2, with either a generator or a catalog crc model
+void part_2(char *input_str, char *generator_str, const CRCModel *model, int threads, int quiet) {
     BitStream *input, *generator;
+    CRCTable *table;
     CRCFrame *frame;
+    StatsMark mark;
     char *output;
 
     if (!quiet) {
@@ -73,64 +180,1033 @@ void part_2(char *input_str, char *generator_str, int quiet) {
         printf("Input: %s\n", input_str);
     }
     
-    input = bitstream_create(strlen(input_str));
-    bitstream_read_from_string(input, input_str);
+    input = read_bitstream(input_str, "input");
+
+    generator = NULL;
+    table = NULL;
+    if (model) {
+        // Catalog models have their tables built in, so there's nothing to set up
+        check_model_input(model, input->length);
 
-    generator = bitstream_create(strlen(generator_str));
-    bitstream_read_from_string(generator, generator_str);
+        STATS_MARK(mark);
+        frame = (CRCFrame*)malloc(sizeof(CRCFrame));
+        frame->frame_bits = input->length + model->width;
+        frame->frame_stream = bitstream_create(frame->frame_bits);
+        crc_model_encode_into(model, input, frame->frame_stream);
+        STATS_RECORD(STATS_CRC_ENCODE, mark, BITSTREAM_BYTES(input->length));
+    } else {
+        generator = read_bitstream(generator_str, "generator");
 
-    frame = crc_encode(input, generator);
+        STATS_MARK(mark);
+        table = crc_table_create(generator);
+        STATS_RECORD(STATS_CRC_TABLE, mark, BITSTREAM_BYTES(generator->length));
+
+        STATS_MARK(mark);
+        frame = crc_encode_parallel(input, table, threads);
+        STATS_RECORD(STATS_CRC_ENCODE, mark, BITSTREAM_BYTES(input->length));
+    }
 
+    STATS_MARK(mark);
     output = (char*)malloc(frame->frame_bits + 1);
     bitstream_write_to_string(frame->frame_stream, output);
+    STATS_RECORD(STATS_FORMAT, mark, frame->frame_bits);
 
+    STATS_MARK(mark);
     if (quiet) {
         printf("%s\n", output);
     } else {
         printf("Output: %s\n", output);
     }
+    fflush(stdout);
+    STATS_RECORD(STATS_OUTPUT, mark, frame->frame_bits + 1);
+
+    if (model && !quiet) {
+        printf("%s: 0x%0*llx\n", model->name, (int)model->width / 4,
+               (unsigned long long)crc_model_checksum(model, input->bytes, input->length / 8));
+    }
 
     free(output);
     crc_destroy(frame);
+    if (table) {
+        crc_table_destroy(table);
+        bitstream_destroy(generator);
+    }
     bitstream_destroy(input);
+}
+
+/// Entry point for part 2 with --verify: checks the input as a received crc frame, fixes it if the error is a single
+/// bit, and outputs the message without its remainder
+void part_2_verify(char *input_str, char *generator_str, int quiet) {
+    BitStream *input, *generator;
+    CRCTable *table;
+    CRCSyndromeTable *syndromes;
+    CRCFrame frame;
+    StatsMark mark;
+    size_t position;
+    char *output;
+
+    if (!quiet) {
+        printf("===== Part 2 =====\n");
+        printf("Input: %s\n", input_str);
+    }
+
+    input = read_bitstream(input_str, "input");
+    generator = read_bitstream(generator_str, "generator");
+
+    STATS_MARK(mark);
+    table = crc_table_create(generator);
+    STATS_RECORD(STATS_CRC_TABLE, mark, BITSTREAM_BYTES(generator->length));
+
+    if (input->length < table->width) {
+        fprintf(stderr, "Invalid input: a frame needs at least %zu bits to hold the remainder\n", table->width);
+        exit(1);
+    }
+
+    frame.frame_stream = input;
+    frame.frame_bits = input->length;
+
+    STATS_MARK(mark);
+    position = crc_verify_table(&frame, table) ? CRC_FRAME_VALID : CRC_FRAME_UNCORRECTABLE;
+    if (position != CRC_FRAME_VALID) {
+        // Only a damaged frame needs the syndrome table, so good frames are checked in a single pass
+        syndromes = crc_syndrome_table_create(table, frame.frame_bits);
+        if (syndromes) {
+            position = crc_fix_error(&frame, syndromes);
+            crc_syndrome_table_destroy(syndromes);
+        }
+    }
+    STATS_RECORD(STATS_CRC_VERIFY, mark, BITSTREAM_BYTES(input->length));
+
+    if (position == CRC_FRAME_UNCORRECTABLE) {
+        fprintf(stderr, "Invalid frame: the remainder doesn't match, and the error is not a single bit\n");
+        exit(1);
+    }
+    if (!quiet) {
+        if (position == CRC_FRAME_VALID) {
+            printf("Status: valid\n");
+        } else {
+            printf("Status: fixed bit %zu\n", position);
+        }
+    }
+
+    // The message is the frame without its remainder
+    bitstream_truncate(input, input->length - table->width);
+
+    STATS_MARK(mark);
+    output = (char*)malloc(input->length + 1);
+    bitstream_write_to_string(input, output);
+    STATS_RECORD(STATS_FORMAT, mark, input->length);
+
+    STATS_MARK(mark);
+    if (quiet) {
+        printf("%s\n", output);
+    } else {
+        printf("Output: %s\n", output);
+    }
+    fflush(stdout);
+    STATS_RECORD(STATS_OUTPUT, mark, input->length + 1);
+
+    free(output);
+    crc_table_destroy(table);
+    bitstream_destroy(generator);
+    bitstream_destroy(input);
+}
+
+/// Makes sure a batch stream has room for nbits bits, growing its words if needed
+void batch_reserve(BitStream *stream, size_t *capacity, size_t nbits) {
+    if (BITSTREAM_WORDS(nbits) + 1 > *capacity) {
+        *capacity = 2 * (BITSTREAM_WORDS(nbits) + 1);
+        stream->words = (uint64_t*)realloc(stream->words, *capacity * sizeof(uint64_t));
+    }
+}
+
+/// Reads a string of 0s and 1s into the batch input, exiting with an error if it contains anything else
+void batch_read_input(Batch *batch, char *str, size_t line) {
+    StatsMark mark;
+    size_t length;
+
+    STATS_MARK(mark);
+    length = strlen(str);
+    batch_reserve(&batch->input, &batch->input_capacity, length);
+    bitstream_init(&batch->input, batch->input.words, length);
+
+    if (bitstream_read_from_string(&batch->input, str) < 0) {
+        fprintf(stderr, "Invalid input on line %zu: %s (must only contain 0 and 1)\n", line, str);
+        exit(1);
+    }
+    STATS_RECORD(STATS_PARSE, mark, length);
+}
+
+/// Returns the crc table for a generator, building it if it isn't one of the last few generators used
+CRCTable *batch_table(Batch *batch, char *generator_str) {
+    BitStream *generator;
+    StatsMark mark;
+    size_t i;
+
+    for (i = 0; i < BATCH_TABLE_CACHE; i++) {
+        if (batch->generators[i] && !strcmp(batch->generators[i], generator_str)) {
+            return batch->tables[i];
+        }
+    }
+
+    // Replace the oldest entry
+    i = batch->next_table;
+    batch->next_table = (batch->next_table + 1) % BATCH_TABLE_CACHE;
+    if (batch->generators[i]) {
+        free(batch->generators[i]);
+        crc_table_destroy(batch->tables[i]);
+    }
+
+    generator = read_bitstream(generator_str, "generator");
+    batch->generators[i] = strdup(generator_str);
+    STATS_MARK(mark);
+    batch->tables[i] = crc_table_create(generator);
+    STATS_RECORD(STATS_CRC_TABLE, mark, BITSTREAM_BYTES(generator->length));
+    bitstream_destroy(generator);
+
+    return batch->tables[i];
+}
+
+/// Writes a result as one line of output
+void batch_write(Batch *batch, const BitStream *result, FILE *out) {
+    StatsMark mark;
+
+    STATS_MARK(mark);
+    if (result->length + 2 > batch->string_capacity) {
+        batch->string_capacity = 2 * (result->length + 2);
+        batch->string = (char*)realloc(batch->string, batch->string_capacity);
+    }
+
+    bitstream_write_to_string(result, batch->string);
+    batch->string[result->length] = '\n';
+    STATS_RECORD(STATS_FORMAT, mark, result->length);
+
+    STATS_MARK(mark);
+    fwrite(batch->string, 1, result->length + 1, out);
+    STATS_RECORD(STATS_OUTPUT, mark, result->length + 1);
+}
+
+/// Entry point for batch mode: runs a part on each line of input_file (or stdin), writing one result per line.
+/// For part 2 each line can give its own generator after the input, separated by a space, which takes the place of
+/// --crc or --generator. With verify, part 2 checks each line as a received frame and writes its message instead
+void run_batch(char *part, char *input_file, char *generator_str, const CRCModel *model, HammingBlockCode *block,
+               int verify) {
+    FILE *in;
+    Batch batch;
+    CRCTable *table;
+    CRCSyndromeTable *syndromes;
+    CRCFrame crc_frame;
+    HammingFrame frame;
+    StatsMark message, mark;
+    char *line, *line_generator;
+    size_t line_capacity, line_number, i;
+    ssize_t line_length;
+
+    if (input_file) {
+        in = fopen(input_file, "r");
+        if (!in) {
+            perror(input_file);
+            exit(1);
+        }
+    } else {
+        in = stdin;
+    }
+    setvbuf(in, NULL, _IOFBF, BATCH_IO_BUFFER);
+    setvbuf(stdout, NULL, _IOFBF, BATCH_IO_BUFFER);
+
+    memset(&batch, 0, sizeof(batch));
+    line = NULL;
+    line_capacity = 0;
+
+    for (line_number = 1; (line_length = getline(&line, &line_capacity, in)) >= 0; line_number++) {
+        STATS_MARK(message);
+
+        // Strip the line ending, and for part 2 split off the generator. The other parts take the whole line, so a
+        // space in it is invalid input
+        while (line_length > 0 && (line[line_length - 1] == '\n' || line[line_length - 1] == '\r')) {
+            line[--line_length] = '\0';
+        }
+        line_generator = model ? NULL : generator_str;
+        i = strcspn(line, " \t");
+        if (!strcmp("2", part) && line[i]) {
+            line[i] = '\0';
+            i += 1 + strspn(&line[i + 1], " \t");
+            if (line[i]) {
+                line_generator = &line[i];
+            }
+        }
+
+        batch_read_input(&batch, line, line_number);
+
+        if (!strcmp("1.1", part)) {
+            // Encode the input into the reused output stream
+            STATS_MARK(mark);
+            if (block) {
+                batch_reserve(&batch.output, &batch.output_capacity,
+                              hamming_block_frame_length(batch.input.length, *block));
+                hamming_block_encode_into(&batch.input, &batch.output, *block);
+            } else {
+                batch_reserve(&batch.output, &batch.output_capacity, hamming_frame_length(batch.input.length));
+                hamming_encode_into(&batch.input, &batch.output);
+            }
+            STATS_RECORD(STATS_HAMMING_ENCODE, mark, BITSTREAM_BYTES(batch.input.length));
+        } else if (!strcmp("1.2", part)) {
+            // Fix the input in place, then decode it into the reused output stream
+            frame.frame_stream = &batch.input;
+            frame.frame_bits = batch.input.length;
+            if (block) {
+                frame.message_bits = hamming_block_message_length(batch.input.length, *block);
+                if (frame.message_bits == HAMMING_BLOCK_INVALID) {
+                    fprintf(stderr, "Invalid input on line %zu: %zu bits is not a valid length for the block code\n",
+                            line_number, batch.input.length);
+                    exit(1);
+                }
+                STATS_MARK(mark);
+                if (hamming_block_fix_errors(&frame, *block)) {
+                    fprintf(stderr, "Warning: line %zu had errors that could not be fixed\n", line_number);
+                }
+                STATS_RECORD(STATS_HAMMING_FIX, mark, BITSTREAM_BYTES(frame.frame_bits));
+                STATS_MARK(mark);
+                batch_reserve(&batch.output, &batch.output_capacity, frame.message_bits);
+                hamming_block_decode_into(&batch.input, &batch.output, *block);
+                STATS_RECORD(STATS_HAMMING_DECODE, mark, BITSTREAM_BYTES(frame.frame_bits));
+            } else {
+                frame.message_bits = hamming_message_length(batch.input.length);
+                STATS_MARK(mark);
+                hamming_fix_errors(&frame);
+                STATS_RECORD(STATS_HAMMING_FIX, mark, BITSTREAM_BYTES(frame.frame_bits));
+                STATS_MARK(mark);
+                batch_reserve(&batch.output, &batch.output_capacity, frame.message_bits);
+                hamming_decode_into(&batch.input, &batch.output);
+                STATS_RECORD(STATS_HAMMING_DECODE, mark, BITSTREAM_BYTES(frame.frame_bits));
+            }
+        } else {
+            if (line_generator && verify) {
+                // Check the frame in place, and only build a syndrome table for the frames that need fixing
+                table = batch_table(&batch, line_generator);
+                if (batch.input.length < table->width) {
+                    fprintf(stderr, "Invalid input on line %zu: a frame needs at least %zu bits\n", line_number,
+                            table->width);
+                    exit(1);
+                }
+                crc_frame.frame_stream = &batch.input;
+                crc_frame.frame_bits = batch.input.length;
+                STATS_MARK(mark);
+                if (!crc_verify_table(&crc_frame, table)) {
+                    syndromes = crc_syndrome_table_create(table, crc_frame.frame_bits);
+                    if (!syndromes || crc_fix_error(&crc_frame, syndromes) == CRC_FRAME_UNCORRECTABLE) {
+                        fprintf(stderr, "Warning: line %zu had errors that could not be fixed\n", line_number);
+                    }
+                    if (syndromes) {
+                        crc_syndrome_table_destroy(syndromes);
+                    }
+                }
+                STATS_RECORD(STATS_CRC_VERIFY, mark, BITSTREAM_BYTES(batch.input.length));
+                batch_reserve(&batch.output, &batch.output_capacity, batch.input.length - table->width);
+                bitstream_init(&batch.output, batch.output.words, batch.input.length - table->width);
+                bitstream_copy_bits(&batch.output, 0, &batch.input, 0, batch.output.length);
+            } else if (line_generator) {
+                table = batch_table(&batch, line_generator);
+                STATS_MARK(mark);
+                batch_reserve(&batch.output, &batch.output_capacity, batch.input.length + strlen(line_generator));
+                crc_encode_into(&batch.input, table, &batch.output);
+                STATS_RECORD(STATS_CRC_ENCODE, mark, BITSTREAM_BYTES(batch.input.length));
+            } else if (model) {
+                // Lines without their own generator use the crc model, if one was given
+                if (batch.input.length % 8) {
+                    fprintf(stderr, "Invalid input on line %zu: %s works on whole bytes\n", line_number, model->name);
+                    exit(1);
+                }
+                STATS_MARK(mark);
+                batch_reserve(&batch.output, &batch.output_capacity, batch.input.length + model->width);
+                crc_model_encode_into(model, &batch.input, &batch.output);
+                STATS_RECORD(STATS_CRC_ENCODE, mark, BITSTREAM_BYTES(batch.input.length));
+            } else {
+                fprintf(stderr, "Missing generator on line %zu\n", line_number);
+                exit(1);
+            }
+        }
+
+        batch_write(&batch, &batch.output, stdout);
+        STATS_MESSAGE(message);
+    }
+
+    fflush(stdout);
+
+    // Clean up
+    for (i = 0; i < BATCH_TABLE_CACHE; i++) {
+        if (batch.generators[i]) {
+            free(batch.generators[i]);
+            crc_table_destroy(batch.tables[i]);
+        }
+    }
+    free(batch.string);
+    free(batch.output.words);
+    free(batch.input.words);
+    free(line);
+    if (in != stdin) {
+        fclose(in);
+    }
+}
+
+/// Loads the input for a formatted run into input. Binary files are used in place, while text is parsed into
+/// a new bitstream (returned through owned, so it can be freed). Exits with an error if the input isn't valid
+void load_input(char *input_str, const DataOptions *options, BitStream *input, MappedFile **file, BitStream **owned) {
+    const char *data;
+    StatsMark mark;
+    size_t size;
+    int result;
+
+    STATS_MARK(mark);
+    *file = NULL;
+    *owned = NULL;
+
+    if (options->input_file) {
+        *file = mapfile_open_read(options->input_file);
+        if (!*file) {
+            perror(options->input_file);
+            exit(1);
+        }
+        data = (const char*)(*file)->bytes;
+        size = (*file)->size;
+    } else {
+        data = input_str;
+        size = strlen(input_str);
+    }
+
+    if (options->in_format == FORMAT_BIN) {
+        if (!*file) {
+            fprintf(stderr, "Binary input has to come from --input-file\n");
+            exit(1);
+        }
+
+        // The mapping already has the layout of a bitstream, so it can be used without a copy
+        input->words = (*file)->words;
+        input->length = size * 8;
+    } else {
+        // Text files usually end with a new line
+        while (size && isspace((unsigned char)data[size - 1])) {
+            size--;
+        }
+
+        if (options->in_format == FORMAT_HEX) {
+            *owned = bitstream_create(size * 4);
+            result = bitstream_read_from_hex(*owned, data, size);
+        } else {
+            *owned = bitstream_create(size);
+            result = bitstream_read_from_chars(*owned, data, size);
+        }
+        if (result < 0) {
+            fprintf(stderr, "Invalid input (must only contain %s)\n",
+                    options->in_format == FORMAT_HEX ? "pairs of hex digits" : "0 and 1");
+            exit(1);
+        }
+        *input = **owned;
+    }
+
+    if (options->input_bits != SIZE_MAX) {
+        if (options->input_bits > input->length) {
+            fprintf(stderr, "Invalid input bits: the input only has %zu bits\n", input->length);
+            exit(1);
+        }
+        bitstream_truncate(input, options->input_bits);
+    }
+    STATS_RECORD(STATS_PARSE, mark, size);
+}
+
+/// Writes the output of a formatted run, to the output file or stdout
+void write_output(const BitStream *output, const DataOptions *options) {
+    MappedFile *file;
+    StatsMark mark;
+    char *text;
+    size_t size;
+
+    // Binary output to a file was written straight into the mapping (and is timed when the mapping is closed)
+    if (options->out_format == FORMAT_BIN) {
+        if (!options->output_file) {
+            STATS_MARK(mark);
+            fwrite(output->bytes, 1, BITSTREAM_BYTES(output->length), stdout);
+            fflush(stdout);
+            STATS_RECORD(STATS_OUTPUT, mark, BITSTREAM_BYTES(output->length));
+        }
+        return;
+    }
+
+    // Text is followed by a new line (which replaces the null terminator)
+    size = options->out_format == FORMAT_HEX ? 2 * BITSTREAM_BYTES(output->length) : output->length;
+    file = NULL;
+    if (options->output_file) {
+        file = mapfile_open_write(options->output_file, size + 1);
+        if (!file) {
+            perror(options->output_file);
+            exit(1);
+        }
+        text = (char*)file->bytes;
+    } else {
+        text = (char*)malloc(size + 1);
+    }
+
+    STATS_MARK(mark);
+    if (options->out_format == FORMAT_HEX) {
+        bitstream_write_to_hex(output, text);
+    } else {
+        bitstream_write_to_string(output, text);
+    }
+    text[size] = '\n';
+    STATS_RECORD(STATS_FORMAT, mark, size);
+
+    STATS_MARK(mark);
+    if (file) {
+        mapfile_close(file);
+    } else {
+        fwrite(text, 1, size + 1, stdout);
+        fflush(stdout);
+        free(text);
+    }
+    STATS_RECORD(STATS_OUTPUT, mark, size + 1);
+}
+
+/// Entry point for runs with --in-format, --out-format, --input-file or --output-file. Only the result is printed,
+/// and binary data is encoded in place in memory mapped files, without going through text
+void run_formatted(char *part, char *input_str, char *generator_str, const CRCModel *model, HammingBlockCode *block,
+                   int threads, const DataOptions *options) {
+    BitStream input, output, *owned_input, *owned_output, *generator;
+    MappedFile *input_file, *output_file;
+    HammingFrame frame;
+    CRCTable *table;
+    StatsMark mark;
+    size_t output_bits;
+
+    load_input(input_str, options, &input, &input_file, &owned_input);
+
+    // Work out how long the output will be, so it can be created in one go
+    table = NULL;
+    if (!strcmp("1.1", part)) {
+        output_bits = block ? hamming_block_frame_length(input.length, *block) : hamming_frame_length(input.length);
+    } else if (!strcmp("1.2", part)) {
+        output_bits = block ? hamming_block_message_length(input.length, *block) : hamming_message_length(input.length);
+        if (output_bits == HAMMING_BLOCK_INVALID) {
+            fprintf(stderr, "Invalid input: %zu bits is not a valid length for the block code\n", input.length);
+            exit(1);
+        }
+    } else if (model) {
+        check_model_input(model, input.length);
+        output_bits = input.length + model->width;
+    } else {
+        generator = read_bitstream(generator_str, "generator");
+        STATS_MARK(mark);
+        table = crc_table_create(generator);
+        STATS_RECORD(STATS_CRC_TABLE, mark, BITSTREAM_BYTES(generator->length));
+        bitstream_destroy(generator);
+        output_bits = input.length + table->width;
+    }
+
+    // Binary output to a file is written straight into the mapping, anything else needs a bitstream first
+    output_file = NULL;
+    owned_output = NULL;
+    if (options->out_format == FORMAT_BIN && options->output_file) {
+        output_file = mapfile_open_write(options->output_file, BITSTREAM_BYTES(output_bits));
+        if (!output_file) {
+            perror(options->output_file);
+            exit(1);
+        }
+        output.words = output_file->words;
+    } else {
+        owned_output = bitstream_create(output_bits);
+        output.words = owned_output->words;
+    }
+
+    if (!strcmp("1.1", part)) {
+        STATS_MARK(mark);
+        if (block) {
+            hamming_block_encode_into(&input, &output, *block);
+        } else {
+            hamming_encode_into(&input, &output);
+        }
+        STATS_RECORD(STATS_HAMMING_ENCODE, mark, BITSTREAM_BYTES(input.length));
+    } else if (!strcmp("1.2", part)) {
+        // The input is fixed in place (for files the mapping is private, so the file isn't changed)
+        frame.frame_stream = &input;
+        frame.frame_bits = input.length;
+        frame.message_bits = output_bits;
+        STATS_MARK(mark);
+        if (block) {
+            if (hamming_block_fix_errors(&frame, *block)) {
+                fprintf(stderr, "Warning: some codewords had errors that could not be fixed\n");
+            }
+        } else {
+            hamming_fix_errors(&frame);
+        }
+        STATS_RECORD(STATS_HAMMING_FIX, mark, BITSTREAM_BYTES(input.length));
+
+        STATS_MARK(mark);
+        if (block) {
+            hamming_block_decode_into(&input, &output, *block);
+        } else {
+            hamming_decode_into(&input, &output);
+        }
+        STATS_RECORD(STATS_HAMMING_DECODE, mark, BITSTREAM_BYTES(input.length));
+    } else {
+        STATS_MARK(mark);
+        if (model) {
+            crc_model_encode_into(model, &input, &output);
+        } else {
+            crc_encode_parallel_into(&input, table, threads, &output);
+        }
+        STATS_RECORD(STATS_CRC_ENCODE, mark, BITSTREAM_BYTES(input.length));
+    }
+
+    write_output(&output, options);
+    fflush(stdout);
+
+    // Binary output to a file is only written out once the mapping is closed
+    if (output_file) {
+        STATS_MARK(mark);
+        mapfile_close(output_file);
+        STATS_RECORD(STATS_OUTPUT, mark, BITSTREAM_BYTES(output_bits));
+    }
+
+    // Clean up
+    if (table) {
+        crc_table_destroy(table);
+    }
+    if (owned_output) {
+        bitstream_destroy(owned_output);
+    }
+    if (input_file) {
+        mapfile_close(input_file);
+    }
+    if (owned_input) {
+        bitstream_destroy(owned_input);
+    }
+}
+
+/// Opens the file for a stream run, or returns the standard stream if there isn't one
+FILE *open_stream_file(char *path, char *mode, FILE *standard) {
+    FILE *file;
+
+    if (!path) {
+        return standard;
+    }
+
+    file = fopen(path, mode);
+    if (!file) {
+        perror(path);
+        exit(1);
+    }
+
+    return file;
+}
+
+/// State shared by the stages of a stream run
+typedef struct {
+    char *part;
+    HammingBlockCode *block;
+    const CRCTable *table;      // For part 2
+    BitStream *remainder;       // For part 2, the remainder of the message so far
+    const CRCModel *model;      // For part 2 with --crc, in place of the table
+    uint64_t crc;               // For part 2 with --crc, the checksum of the message so far
+} StreamJob;
+
+/// Works on one chunk of a stream: encodes it as a frame, fixes and decodes a frame, or finds its crc remainder
+void stream_work(void *arg, BitStream *input, BitStream *output) {
+    StreamJob *job;
+    HammingFrame frame;
+    CRCContext *ctx;
+    BitStream *remainder;
+    StatsMark message, mark;
+
+    job = (StreamJob*)arg;
+    STATS_MARK(message);
+
+    if (!strcmp("1.1", job->part)) {
+        mark = message;
+        if (job->block) {
+            hamming_block_encode_into(input, output, *job->block);
+        } else {
+            hamming_encode_into(input, output);
+        }
+        STATS_RECORD(STATS_HAMMING_ENCODE, mark, BITSTREAM_BYTES(input->length));
+    } else if (!strcmp("1.2", job->part)) {
+        frame.frame_stream = input;
+        frame.frame_bits = input->length;
+        if (job->block) {
+            frame.message_bits = hamming_block_message_length(input->length, *job->block);
+            if (frame.message_bits == HAMMING_BLOCK_INVALID) {
+                fprintf(stderr, "Invalid input: %zu bits is not a valid length for the block code\n", input->length);
+                exit(1);
+            }
+            STATS_MARK(mark);
+            if (hamming_block_fix_errors(&frame, *job->block)) {
+                fprintf(stderr, "Warning: some codewords had errors that could not be fixed\n");
+            }
+            STATS_RECORD(STATS_HAMMING_FIX, mark, BITSTREAM_BYTES(input->length));
+            STATS_MARK(mark);
+            hamming_block_decode_into(input, output, *job->block);
+            STATS_RECORD(STATS_HAMMING_DECODE, mark, BITSTREAM_BYTES(input->length));
+        } else {
+            STATS_MARK(mark);
+            hamming_fix_errors(&frame);
+            STATS_RECORD(STATS_HAMMING_FIX, mark, BITSTREAM_BYTES(input->length));
+            STATS_MARK(mark);
+            hamming_decode_into(input, output);
+            STATS_RECORD(STATS_HAMMING_DECODE, mark, BITSTREAM_BYTES(input->length));
+        }
+    } else if (job->model) {
+        // A model's checksum is kept as a number, so the chunk's checksum goes in the output's first word
+        mark = message;
+        if (input->length % 8) {
+            fprintf(stderr, "Invalid input: %s works on whole bytes\n", job->model->name);
+            exit(1);
+        }
+        bitstream_init(output, output->words, 64);
+        output->words[0] = crc_model_checksum(job->model, input->bytes, input->length / 8);
+        STATS_RECORD(STATS_CRC_ENCODE, mark, BITSTREAM_BYTES(input->length));
+    } else {
+        // Each chunk's remainder is found on its own, and they're combined in order as they're written
+        mark = message;
+        ctx = crc_init_table(job->table);
+        crc_update(ctx, input->bytes, input->length);
+        remainder = crc_finalize(ctx);
+        bitstream_init(output, output->words, remainder->length);
+        bitstream_copy_bits(output, 0, remainder, 0, remainder->length);
+        bitstream_destroy(remainder);
+        STATS_RECORD(STATS_CRC_ENCODE, mark, BITSTREAM_BYTES(input->length));
+    }
+
+    // The latency of a chunk is how long it takes to work on (reading and writing it overlap in a pipeline)
+    STATS_MESSAGE(message);
+}
+
+/// Writes out one chunk of a stream, in order
+void stream_emit(void *arg, const BitStream *input, const BitStream *output, BitWriter *writer) {
+    StreamJob *job;
+    BitStream *combined;
+    StatsMark mark;
+
+    job = (StreamJob*)arg;
+    STATS_MARK(mark);
+
+    if (job->model) {
+        bitwriter_write(writer, input);
+        job->crc = crc_model_combine(job->model, job->crc, output->words[0], input->length / 8);
+    } else if (job->table) {
+        // The frame starts with the message itself, so it can be written as it goes
+        bitwriter_write(writer, input);
+        combined = crc_combine_table(job->remainder, output, input->length, job->table);
+        bitstream_destroy(job->remainder);
+        job->remainder = combined;
+    } else {
+        bitwriter_write(writer, output);
+    }
+    STATS_RECORD(STATS_OUTPUT, mark, BITSTREAM_BYTES(job->table || job->model ? input->length : output->length));
+}
+
+/// Entry point for stream mode: reads the input (from --input-file or stdin) chunk_bits bits at a time, so any size
+/// of input can be handled in constant memory. Part 1.1 encodes each chunk as its own frame and part 1.2 decodes
+/// those frames, while part 2 feeds the chunks through a running crc and gives the same output as a normal run.
+/// With more than one thread the chunks go through a pipeline, with reading, the work and writing all overlapped
+void run_stream(char *part, char *generator_str, const CRCModel *model, HammingBlockCode *block, int threads,
+                int quiet, const DataOptions *options, size_t chunk_bits) {
+    FILE *in, *out;
+    BitReader reader;
+    BitWriter writer;
+    BitStream chunk, output, *generator, checksum;
+    StreamJob job;
+    PipelineConfig config;
+    PipelineStats stats;
+    CRCTable *table;
+    StatsMark mark;
+    uint64_t checksum_word;
+    size_t message_bits, frame_bits, read_bits, output_bits, i;
+    int result;
+
+    // Block codes need each chunk to be whole codewords, so the output is the same as encoding it all at once. This
+    // rounds up, so a chunk is never less than one codeword
+    if (block) {
+        message_bits = hamming_block_message_bits(*block);
+        chunk_bits += message_bits - 1;
+        chunk_bits -= chunk_bits % message_bits;
+    }
+    // And crc models need whole bytes
+    if (model) {
+        chunk_bits += 7;
+        chunk_bits -= chunk_bits % 8;
+    }
+    frame_bits = block ? hamming_block_frame_length(chunk_bits, *block) : hamming_frame_length(chunk_bits);
+
+    // Part 1.2 reads whole frames, everything else reads chunks of the message
+    read_bits = !strcmp("1.2", part) ? frame_bits : chunk_bits;
+
+    in = open_stream_file(options->input_file, "rb", stdin);
+    out = open_stream_file(options->output_file, "wb", stdout);
+    bitreader_init(&reader, in, options->in_format, options->input_bits);
+    bitwriter_init(&writer, out, options->out_format);
+
+    job.part = part;
+    job.block = block;
+    job.table = NULL;
+    job.remainder = NULL;
+    job.model = NULL;
+    table = NULL;
+    if (!strcmp("2", part) && model) {
+        job.model = model;
+        job.crc = crc_model_begin(model);
+    } else if (!strcmp("2", part)) {
+        generator = read_bitstream(generator_str, "generator");
+        STATS_MARK(mark);
+        table = crc_table_create(generator);
+        STATS_RECORD(STATS_CRC_TABLE, mark, BITSTREAM_BYTES(generator->length));
+        bitstream_destroy(generator);
+        job.table = table;
+        job.remainder = bitstream_create(table->width);
+    }
+
+    // Part 2 gives back the remainder for every chunk, which can be wider than a frame when the chunks are small
+    output_bits = frame_bits;
+    if (table && table->width > output_bits) {
+        output_bits = table->width;
+    }
+
+    // If the pipeline's threads can't be started it hasn't read anything, so this falls back to the loop below
+    result = -2;
+    if (threads > 1) {
+        config.workers = threads;
+        config.chunk_bits = read_bits;
+        config.output_bits = output_bits;
+        config.work = stream_work;
+        config.emit = stream_emit;
+        config.arg = &job;
+
+        result = pipeline_run(&config, &reader, &writer, &stats);
+        if (!quiet && result != -2) {
+            pipeline_report(&stats, stderr);
+        }
+        pipeline_stats_free(&stats);
+    }
+    if (result == -2) {
+        // The only buffers are one chunk of input and one of output, so memory doesn't depend on the input size
+        chunk.words = (uint64_t*)malloc((BITSTREAM_WORDS(frame_bits) + 1) * sizeof(uint64_t));
+        output.words = (uint64_t*)malloc((BITSTREAM_WORDS(output_bits) + 1) * sizeof(uint64_t));
+
+        for (;;) {
+            STATS_MARK(mark);
+            if ((result = bitreader_read(&reader, &chunk, read_bits)) || !chunk.length) {
+                break;
+            }
+            STATS_RECORD(STATS_PARSE, mark, BITSTREAM_BYTES(chunk.length));
+
+            stream_work(&job, &chunk, &output);
+            stream_emit(&job, &chunk, &output, &writer);
+        }
+
+        free(output.words);
+        free(chunk.words);
+    }
+
+    if (result < 0) {
+        fprintf(stderr, "Invalid input\n");
+        exit(1);
+    }
+
+    if (job.model) {
+        // The checksum goes on the end in the model's byte order, the same as crc_model_encode_into
+        bitstream_init(&checksum, &checksum_word, model->width);
+        for (i = 0; i < model->width / 8; i++) {
+            checksum.bytes[i] = (uint8_t)(job.crc >> (model->refout ? 8 * i : model->width - 8 * (i + 1)));
+        }
+        bitwriter_write(&writer, &checksum);
+    }
+    if (table) {
+        bitwriter_write(&writer, job.remainder);
+        bitstream_destroy(job.remainder);
+        crc_table_destroy(table);
+    }
+
+    bitwriter_finish(&writer);
+    bitreader_free(&reader);
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (out != stdout) {
+        fclose(out);
+    } else {
+        fflush(stdout);
+    }
+}
+
+/// Runs part 2 in stream mode through files with a generator much wider than the chunks, with and without the
+/// pipeline, and checks the output matches a normal run
+void stream_test() {
+    BitStream *input, *generator;
+    CRCTable *table;
+    CRCFrame *frame;
+    DataOptions options;
+    FILE *file;
+    char input_path[] = "/tmp/pj1_stream_XXXXXX", output_path[] = "/tmp/pj1_stream_XXXXXX";
+    char *input_str, *generator_str, *expected, *actual;
+    size_t length, threads, n, i;
+    int fd;
+
+    printf("  => Testing stream functions\n");
+
+    length = 1000;
+    input = bitstream_create(length);
+    for (i = 0; i < length; i++) {
+        bitstream_set(input, i, rand() & 1);
+    }
+    generator = bitstream_create(200);
+    for (i = 0; i < generator->length; i++) {
+        bitstream_set(generator, i, !i || i == generator->length - 1 || (rand() & 1));
+    }
+
+    input_str = (char*)malloc(input->length + 1);
+    bitstream_write_to_string(input, input_str);
+    generator_str = (char*)malloc(generator->length + 1);
+    bitstream_write_to_string(generator, generator_str);
+
+    // A normal run, with a newline on the end like the stream writer gives
+    table = crc_table_create(generator);
+    frame = crc_encode_table(input, table);
+    expected = (char*)malloc(frame->frame_bits + 1);
+    bitstream_write_to_string(frame->frame_stream, expected);
+    expected[frame->frame_bits] = '\n';
+    actual = (char*)malloc(frame->frame_bits + 2);
+
+    fd = mkstemp(input_path);
+    assert(fd >= 0);
+    file = fdopen(fd, "wb");
+    fputs(input_str, file);
+    fclose(file);
+    fd = mkstemp(output_path);
+    assert(fd >= 0);
+    close(fd);
+
+    options.in_format = FORMAT_ASCII;
+    options.out_format = FORMAT_ASCII;
+    options.input_file = input_path;
+    options.output_file = output_path;
+    options.input_bits = SIZE_MAX;
+
+    for (threads = 1; threads <= 3; threads += 2) {
+        run_stream("2", generator_str, NULL, NULL, threads, 1, &options, 8);
+
+        file = fopen(output_path, "rb");
+        assert(file);
+        n = fread(actual, 1, frame->frame_bits + 2, file);
+        assert(n == frame->frame_bits + 1);
+        assert(!memcmp(actual, expected, n));
+        fclose(file);
+    }
+
+    unlink(input_path);
+    unlink(output_path);
+    free(actual);
+    free(expected);
+    free(generator_str);
+    free(input_str);
+    bitstream_destroy(frame->frame_stream);
+    free(frame);
+    crc_table_destroy(table);
     bitstream_destroy(generator);
+    bitstream_destroy(input);
+
+    printf("    => Stream tests passed!\n");
 }
 
 /// Prints information about how to use the program
 void print_usage() {
+    size_t i;
+
     printf("Usage:\n");
-    printf("pj1 --part={part} --input={input} [--generator={generator}] [--test] [--quiet]\n");
+    printf("pj1 --part={part} --input={input} [--generator={generator} | --crc={crc}] [--threads={threads}]\n");
+    printf("    [--block={block}] [--verify] [--test] [--quiet] [--stats]\n");
+    printf("pj1 --part={part} --batch [--input-file={file}] [--generator={generator} | --crc={crc}] [--block={block}]\n");
+    printf("    [--verify]\n");
+    printf("pj1 --part={part} [--input={input} | --input-file={file}] [--in-format={format}] [--out-format={format}]\n");
+    printf("    [--input-bits={bits}] [--output-file={file}] [--generator={generator} | --crc={crc}]\n");
+    printf("    [--threads={threads}] [--block={block}]\n");
+    printf("pj1 --part={part} --stream [--chunk-bits={bits}] [--input-file={file}] [--output-file={file}]\n");
+    printf("    [--in-format={format}] [--out-format={format}] [--input-bits={bits}]\n");
+    printf("    [--generator={generator} | --crc={crc}] [--block={block}]\n");
     printf("\n");
     printf("Where:\n");
     printf("       {part}: The part to run (1.1, 1.2, or 2)\n");
     printf("      {input}: The input to use\n");
     printf("  {generator}: The generator to use for part 2 (required for part 2, ignored otherwise)\n");
+    printf("        {crc}: A standard crc to use for part 2 in place of a generator, on whole bytes:\n");
+    printf("              ");
+    for (i = 0; i < crc_model_count; i++) {
+        printf(" %s", crc_models[i].name);
+    }
     printf("\n");
-    printf("--test and --quiet are optional, and do the following:\n");
+    printf("    {threads}: The number of threads to use for part 2 (defaults to 1)\n");
+    printf("      {block}: Encode parts 1.1 and 1.2 as fixed size codewords: 7,4 15,11 31,26 or 72,64 (SECDED)\n");
+    printf("               (by default the whole input is one hamming frame)\n");
+    printf("       {file}: The file to read inputs from, or write the output to\n");
+    printf("     {format}: How the input or output data is written: ascii (0s and 1s, the default), bin (raw bytes,\n");
+    printf("               first bit in the lowest bit of the first byte) or hex (those bytes as hex digits)\n");
+    printf("       {bits}: For --input-bits, the number of bits to use from the input, for binary or hex input that\n");
+    printf("               isn't whole bytes. For --chunk-bits, the message bits in each chunk of a stream\n");
+    printf("\n");
+    printf("--test, --quiet, --stats, --verify, --batch and --stream are optional, and do the following:\n");
     printf("   --test: Runs tests\n");
     printf("  --quiet: Supresses any output other than the final output of the program\n");
+    printf("  --stats: Prints the time, throughput and allocations of each stage of the run to stderr, and the\n");
+    printf("           p50/p99 latency of each message for batches and streams\n");
+    printf(" --verify: For part 2, checks the input as a received frame (with --generator), fixes a single bit\n");
+    printf("           error if there is one, and outputs the message without its remainder\n");
+    printf("  --batch: Runs the part on every line of input, writing one output per line. For part 2 a line can give\n");
+    printf("           its own generator after the input, separated by a space\n");
+    printf(" --stream: Reads the input (from --input-file or stdin) a chunk at a time, in constant memory. Part 1.1\n");
+    printf("           encodes each chunk as its own hamming frame, and part 1.2 decodes a stream of those frames\n");
 }
 
 /// Runs a series of tests for the code
 void run_tests() {
     printf("===== Running tests =====\n");
 
+    arena_test();
     bitstream_test();
+    bitio_test();
+    pipeline_test();
+    stats_test();
     crc_test();
     hamming_test();
+    stream_test();
 
     printf("Tests passed!\n");
 }
 
 int main(int argc, char **argv) {
-    int i, test, quiet;
+    int i, test, quiet, batch, stream, threads, stats, verify;
+    size_t chunk_bits;
     char *arg;
+    HammingBlockCode block_code;
 
     char *part = NULL;
     char *input = NULL;
     char *generator = NULL;
+    const CRCModel *model = NULL;
+    HammingBlockCode *block = NULL;
+    DataOptions options;
+    int formatted;
 
     test = 0;
+    quiet = 0;
+    batch = 0;
+    stream = 0;
+    stats = 0;
+    verify = 0;
+    chunk_bits = STREAM_CHUNK_BITS;
+    threads = 1;
+    formatted = 0;
+    options.in_format = FORMAT_ASCII;
+    options.out_format = FORMAT_ASCII;
+    options.input_file = NULL;
+    options.output_file = NULL;
+    options.input_bits = SIZE_MAX;
 
     // Go through args looking for --part= and --input= to set part and input
     for (i = 1; i < argc; i++) {
@@ -145,12 +1221,63 @@ int main(int argc, char **argv) {
         } else if (!strncmp("--generator=", arg, 12)) {
             // If this argument starts with "--generator=" set generator
             generator = &arg[12];
+        } else if (!strncmp("--crc=", arg, 6)) {
+            // If this argument starts with "--crc=" use that standard crc in place of a generator
+            model = crc_model_find(&arg[6]);
+            if (!model) {
+                print_usage();
+                exit(1);
+            }
+        } else if (!strncmp("--threads=", arg, 10)) {
+            // If this argument starts with "--threads=" set the number of threads
+            threads = atoi(&arg[10]);
+        } else if (!strncmp("--block=", arg, 8)) {
+            // If this argument starts with "--block=" use a fixed size block code for part 1
+            if (hamming_block_parse(&arg[8], &block_code) < 0) {
+                print_usage();
+                exit(1);
+            }
+            block = &block_code;
+        } else if (!strncmp("--input-file=", arg, 13)) {
+            // If this argument starts with "--input-file=" read the input (or batch inputs) from that file
+            options.input_file = &arg[13];
+            formatted = 1;
+        } else if (!strncmp("--output-file=", arg, 14)) {
+            // If this argument starts with "--output-file=" write the output to that file
+            options.output_file = &arg[14];
+            formatted = 1;
+        } else if (!strncmp("--in-format=", arg, 12) || !strncmp("--out-format=", arg, 13)) {
+            // If this argument starts with "--in-format=" or "--out-format=" set the format of the input or output
+            if (bitio_parse_format(strchr(arg, '=') + 1, arg[2] == 'i' ? &options.in_format : &options.out_format) < 0) {
+                print_usage();
+                exit(1);
+            }
+            formatted = 1;
+        } else if (!strncmp("--input-bits=", arg, 13)) {
+            // If this argument starts with "--input-bits=" only use that many bits of the input
+            options.input_bits = strtoull(&arg[13], NULL, 10);
+            formatted = 1;
+        } else if (!strcmp("--stream", arg)) {
+            // If this argument is --stream, go in to stream mode
+            stream = 1;
+        } else if (!strncmp("--chunk-bits=", arg, 13)) {
+            // If this argument starts with "--chunk-bits=" set the size of each chunk in stream mode
+            chunk_bits = strtoull(&arg[13], NULL, 10);
+        } else if (!strcmp("--batch", arg)) {
+            // If this argument is --batch, go in to batch mode
+            batch = 1;
         } else if (!strcmp("--test", arg)) {
             // If this argument is --test, go in to test mode
             test = 1;
         } else if (!strcmp("--quiet", arg)) {
             // If this argument is --quiet, go in to quiet mode
             quiet = 1;
+        } else if (!strcmp("--verify", arg)) {
+            // If this argument is --verify, check part 2 inputs as received frames instead of encoding them
+            verify = 1;
+        } else if (!strcmp("--stats", arg)) {
+            // If this argument is --stats, time each stage of the run and report it at the end
+            stats = 1;
         }
     }
 
@@ -160,35 +1287,96 @@ int main(int argc, char **argv) {
         exit(0);
     }
 
-    // Both part and input must be specified to run
-    if (!part || !input) {
+    if (stats) {
+        stats_start();
+    }
+
+    // Verifying works on frames with a generator, not the byte oriented crc models
+    if (verify && (model || stream || (formatted && !batch))) {
+        print_usage();
+        exit(1);
+    }
+
+    // Batch mode reads its inputs one per line, so only needs the part
+    if (batch) {
+        if (!part || (strcmp("1.1", part) && strcmp("1.2", part) && strcmp("2", part))) {
+            print_usage();
+            exit(1);
+        }
+
+        run_batch(part, options.input_file, generator, model, block, verify);
+        if (stats) {
+            stats_report(stderr);
+        }
+        exit(0);
+    }
+
+    // Stream mode reads its input from a file or stdin, so only needs the part (and a generator for part 2)
+    if (stream) {
+        if (!part || (strcmp("1.1", part) && strcmp("1.2", part) && strcmp("2", part)) ||
+            (!strcmp("2", part) && !generator && !model) || !chunk_bits || threads < 1) {
+            print_usage();
+            exit(1);
+        }
+
+        run_stream(part, generator, model, block, threads, quiet, &options, chunk_bits);
+        if (stats) {
+            stats_report(stderr);
+        }
+        exit(0);
+    }
+
+    // Both part and input must be specified to run, with at least one thread
+    if (!part || (!input && !options.input_file) || threads < 1) {
         // If either was not given, print usage and exit
         print_usage();
         exit(1);
     }
 
+    // Runs with files or other formats handle every part the same way
+    if (formatted) {
+        if ((strcmp("1.1", part) && strcmp("1.2", part) && strcmp("2", part)) || (!strcmp("2", part) && !generator && !model)) {
+            print_usage();
+            exit(1);
+        }
+
+        run_formatted(part, input, generator, model, block, threads, &options);
+        if (stats) {
+            stats_report(stderr);
+        }
+        exit(0);
+    }
+
     // Determine which part to run
     if (!strcmp("1.1", part)) {
         // Run part 1.1
-        part_1_1(input, quiet);
+        part_1_1(input, block, quiet);
     } else if (!strcmp("1.2", part)) {
         // Run part 1.2
-        part_1_2(input, quiet);
+        part_1_2(input, block, quiet);
     } else if (!strcmp("2", part)) {
-        // Check for generator for part 2
-        if (!generator) {
+        // Check for a generator or crc model for part 2
+        if (!generator && !model) {
             print_usage();
             exit(1);
         }
 
-        // Run part 2
-        part_2(input, generator, quiet);
+        // Run part 2, or check the input as a frame with --verify
+        if (verify) {
+            part_2_verify(input, generator, quiet);
+        } else {
+            part_2(input, generator, model, threads, quiet);
+        }
     } else {
         // If the part given was not valid print usage and exit
         print_usage();
         exit(1);
     }
 
+    if (stats) {
+        stats_report(stderr);
+    }
+
     exit(0);
 }
 
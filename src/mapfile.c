@@ -0,0 +1,92 @@
+#include <mapfile.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Stands in for the mapping of an empty file, which mmap can't map
+static uint64_t mapfile_empty[2];
+
+/// Maps size bytes of an open file (or points at mapfile_empty if size is 0). Returns -1 if the mapping failed
+static int mapfile_map(MappedFile *file, int fd, size_t size, int prot, int flags) {
+    void *data;
+
+    file->size = size;
+    file->mapped = size;
+    if (!size) {
+        file->words = mapfile_empty;
+        return 0;
+    }
+
+    // The mapping is whole pages, and the end of the last page past the end of the file reads as 0. As the page
+    // size is a multiple of 8, the file can always be used as the words of a bitstream without a copy
+    data = mmap(NULL, size, prot, flags, fd, 0);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    file->bytes = (unsigned char*)data;
+
+    return 0;
+}
+
+/// Maps a file for reading. Writes to the mapping are private, so the file itself is never changed.
+/// Returns NULL (with errno set) if the file can't be opened or mapped
+MappedFile* mapfile_open_read(const char *path) {
+    MappedFile *file;
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    file = (MappedFile*)malloc(sizeof(MappedFile));
+    if (fstat(fd, &st) < 0 || mapfile_map(file, fd, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE) < 0) {
+        free(file);
+        close(fd);
+        return NULL;
+    }
+
+    // Most uses read the whole file front to back
+    if (file->mapped) {
+        madvise(file->bytes, file->mapped, MADV_SEQUENTIAL);
+    }
+
+    // The mapping stays valid after the file is closed
+    close(fd);
+
+    return file;
+}
+
+/// Creates (or truncates) a file of the given size, and maps it for writing.
+/// Returns NULL (with errno set) if the file can't be created or mapped
+MappedFile* mapfile_open_write(const char *path, size_t size) {
+    MappedFile *file;
+    int fd;
+
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    file = (MappedFile*)malloc(sizeof(MappedFile));
+    if (ftruncate(fd, size) < 0 || mapfile_map(file, fd, size, PROT_READ | PROT_WRITE, MAP_SHARED) < 0) {
+        free(file);
+        close(fd);
+        return NULL;
+    }
+
+    close(fd);
+
+    return file;
+}
+
+/// Unmaps a file (any writes reach the file when it is unmapped, if not before)
+void mapfile_close(MappedFile *file) {
+    if (file->mapped) {
+        munmap(file->bytes, file->mapped);
+    }
+    free(file);
+}
@@ -0,0 +1,28 @@
+#ifndef __MAPFILE_H__
+#define __MAPFILE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// A file mapped into memory, so it can be read or written in place without copying it through a buffer
+typedef struct {
+    union {
+        uint64_t *words;
+        unsigned char *bytes;
+    };
+    size_t size;        // Size of the file in bytes
+    size_t mapped;      // Size of the mapping in bytes (0 for an empty file, which points at a zero word instead)
+} MappedFile;
+
+/// Maps a file for reading. Writes to the mapping are private, so the file itself is never changed.
+/// Returns NULL (with errno set) if the file can't be opened or mapped
+MappedFile* mapfile_open_read(const char *path);
+
+/// Creates (or truncates) a file of the given size, and maps it for writing.
+/// Returns NULL (with errno set) if the file can't be created or mapped
+MappedFile* mapfile_open_write(const char *path, size_t size);
+
+/// Unmaps a file (any writes reach the file when it is unmapped, if not before)
+void mapfile_close(MappedFile *file);
+
+#endif // __MAPFILE_H__
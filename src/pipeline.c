@@ -0,0 +1,383 @@
+#include <pipeline.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+/// Everything the threads of a pipeline share
+typedef struct {
+    const PipelineConfig *config;
+    BitWriter *writer;
+    PipelineRing free_ring;         // Finished chunks, from the writer back to the reader
+    PipelineRing *input_rings;      // Chunks to work on, from the reader to each worker
+    PipelineRing *output_rings;     // Worked on chunks, from each worker to the writer
+    PipelineStats *stats;
+} Pipeline;
+
+/// Passed to each worker thread
+typedef struct {
+    Pipeline *pipeline;
+    size_t index;
+} PipelineWorker;
+
+// Put on the rings after the last chunk, to tell the next stage to stop
+static PipelineChunk pipeline_end = {.end = 1};
+
+/// Returns the current time in seconds, from a monotonic clock
+static double pipeline_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// Sets up an empty ring with room for at least size chunks
+static void pipeline_ring_init(PipelineRing *ring, size_t size) {
+    for (ring->capacity = 1; ring->capacity < size; ring->capacity *= 2) {}
+    ring->slots = (PipelineChunk**)malloc(ring->capacity * sizeof(PipelineChunk*));
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->occupancy_total = 0;
+    ring->occupancy_max = 0;
+    ring->puts = 0;
+}
+
+/// Puts a chunk on the ring (only called by its producer), waiting for a free slot if it's full
+static void pipeline_ring_put(PipelineRing *ring, PipelineChunk *chunk) {
+    size_t tail, occupancy;
+
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while ((occupancy = tail - atomic_load_explicit(&ring->head, memory_order_acquire)) == ring->capacity) {
+        sched_yield();
+    }
+
+    ring->slots[tail & (ring->capacity - 1)] = chunk;
+
+    // The release makes the slot visible to the consumer before the new tail is
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    ring->occupancy_total += occupancy;
+    if (occupancy > ring->occupancy_max) {
+        ring->occupancy_max = occupancy;
+    }
+    ring->puts++;
+}
+
+/// Takes the next chunk off the ring (only called by its consumer), waiting for one if it's empty
+static PipelineChunk* pipeline_ring_take(PipelineRing *ring) {
+    PipelineChunk *chunk;
+    size_t head;
+
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (head == atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+        sched_yield();
+    }
+
+    chunk = ring->slots[head & (ring->capacity - 1)];
+
+    // The release stops the producer reusing the slot until it has been read
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    return chunk;
+}
+
+/// Works on every chunk from one input ring, until the end marker
+static void* pipeline_worker(void *arg) {
+    PipelineWorker *worker;
+    PipelineChunk *chunk;
+    PipelineStageStats *stats;
+    double start;
+
+    worker = (PipelineWorker*)arg;
+    stats = &worker->pipeline->stats->workers[worker->index];
+
+    while (!(chunk = pipeline_ring_take(&worker->pipeline->input_rings[worker->index]))->end) {
+        start = pipeline_now();
+        worker->pipeline->config->work(worker->pipeline->config->arg, &chunk->input, &chunk->output);
+        stats->seconds += pipeline_now() - start;
+        stats->bits += chunk->input.length;
+
+        pipeline_ring_put(&worker->pipeline->output_rings[worker->index], chunk);
+    }
+
+    pipeline_ring_put(&worker->pipeline->output_rings[worker->index], chunk);
+
+    return NULL;
+}
+
+/// Writes out the chunks in the order they were read. The reader deals them out to the workers in turn, so taking
+/// them back from each worker in turn keeps them in order
+static void* pipeline_writer(void *arg) {
+    Pipeline *pipeline;
+    PipelineChunk *chunk;
+    double start;
+    size_t worker;
+
+    pipeline = (Pipeline*)arg;
+
+    for (worker = 0; !(chunk = pipeline_ring_take(&pipeline->output_rings[worker]))->end;
+         worker = (worker + 1) % pipeline->config->workers) {
+        start = pipeline_now();
+        pipeline->config->emit(pipeline->config->arg, &chunk->input, &chunk->output, pipeline->writer);
+        pipeline->stats->writer.seconds += pipeline_now() - start;
+        pipeline->stats->writer.bits += chunk->input.length;
+
+        pipeline_ring_put(&pipeline->free_ring, chunk);
+    }
+
+    return NULL;
+}
+
+/// Reads chunks with the reader thread (this one), works on them with config->workers threads, and writes them in
+/// order with a writer thread. Returns 0 on success, -1 if the input was invalid, or -2 if the threads couldn't be
+/// started, in which case nothing has been read. If stats isn't NULL it's filled in, and its workers array needs
+/// freeing with pipeline_stats_free
+int pipeline_run(const PipelineConfig *config, BitReader *reader, BitWriter *writer, PipelineStats *stats) {
+    Pipeline pipeline;
+    PipelineStats local_stats;
+    PipelineWorker *workers;
+    PipelineChunk *chunks, *chunk;
+    pthread_t *threads, writer_thread;
+    size_t nchunks, started, worker, i;
+    double start, read_start;
+    int writer_started, result;
+
+    start = pipeline_now();
+
+    pipeline.config = config;
+    pipeline.writer = writer;
+    pipeline.stats = stats ? stats : &local_stats;
+    memset(pipeline.stats, 0, sizeof(PipelineStats));
+    pipeline.stats->nworkers = config->workers;
+    pipeline.stats->workers = (PipelineStageStats*)calloc(config->workers, sizeof(PipelineStageStats));
+
+    // Every chunk (and an end marker) fits in every ring, so the only waiting is for chunks to arrive
+    nchunks = config->workers * PIPELINE_DEPTH;
+    pipeline_ring_init(&pipeline.free_ring, nchunks + 1);
+    pipeline.input_rings = (PipelineRing*)malloc(config->workers * sizeof(PipelineRing));
+    pipeline.output_rings = (PipelineRing*)malloc(config->workers * sizeof(PipelineRing));
+    for (worker = 0; worker < config->workers; worker++) {
+        pipeline_ring_init(&pipeline.input_rings[worker], nchunks + 1);
+        pipeline_ring_init(&pipeline.output_rings[worker], nchunks + 1);
+    }
+
+    // All the buffers are allocated up front, and just go round the rings
+    chunks = (PipelineChunk*)malloc(nchunks * sizeof(PipelineChunk));
+    for (i = 0; i < nchunks; i++) {
+        chunks[i].input.words = (uint64_t*)malloc((BITSTREAM_WORDS(config->chunk_bits) + 1) * sizeof(uint64_t));
+        chunks[i].output.words = (uint64_t*)malloc((BITSTREAM_WORDS(config->output_bits) + 1) * sizeof(uint64_t));
+        chunks[i].end = 0;
+        pipeline_ring_put(&pipeline.free_ring, &chunks[i]);
+    }
+
+    workers = (PipelineWorker*)malloc(config->workers * sizeof(PipelineWorker));
+    threads = (pthread_t*)malloc(config->workers * sizeof(pthread_t));
+    result = 0;
+    for (started = 0; started < config->workers; started++) {
+        workers[started].pipeline = &pipeline;
+        workers[started].index = started;
+        if (pthread_create(&threads[started], NULL, pipeline_worker, &workers[started])) {
+            result = -2;
+            break;
+        }
+    }
+    writer_started = !result && !pthread_create(&writer_thread, NULL, pipeline_writer, &pipeline);
+    if (!writer_started) {
+        result = -2;
+    }
+
+    // Deal the chunks out to the workers in turn, until the input runs out. If any thread didn't start nothing is
+    // read, and the workers that did start are just sent the end marker
+    for (worker = 0; !result; worker = (worker + 1) % config->workers) {
+        chunk = pipeline_ring_take(&pipeline.free_ring);
+
+        read_start = pipeline_now();
+        if (bitreader_read(reader, &chunk->input, config->chunk_bits) < 0) {
+            result = -1;
+            break;
+        }
+        pipeline.stats->reader.seconds += pipeline_now() - read_start;
+
+        if (!chunk->input.length) {
+            break;
+        }
+        pipeline.stats->reader.bits += chunk->input.length;
+        pipeline.stats->chunks++;
+
+        pipeline_ring_put(&pipeline.input_rings[worker], chunk);
+    }
+
+    // The end marker goes to every worker, starting with the one the writer will look at next
+    for (i = 0; i < started; i++) {
+        pipeline_ring_put(&pipeline.input_rings[(worker + i) % config->workers], &pipeline_end);
+    }
+    for (worker = 0; worker < started; worker++) {
+        pthread_join(threads[worker], NULL);
+    }
+    if (writer_started) {
+        pthread_join(writer_thread, NULL);
+    }
+
+    pipeline.stats->elapsed = pipeline_now() - start;
+    for (worker = 0; worker < config->workers; worker++) {
+        pipeline.stats->input_occupancy += pipeline.input_rings[worker].occupancy_total;
+        pipeline.stats->output_occupancy += pipeline.output_rings[worker].occupancy_total;
+        if (pipeline.input_rings[worker].occupancy_max > pipeline.stats->input_max) {
+            pipeline.stats->input_max = pipeline.input_rings[worker].occupancy_max;
+        }
+        if (pipeline.output_rings[worker].occupancy_max > pipeline.stats->output_max) {
+            pipeline.stats->output_max = pipeline.output_rings[worker].occupancy_max;
+        }
+    }
+    if (pipeline.stats->chunks) {
+        pipeline.stats->input_occupancy /= pipeline.stats->chunks;
+        pipeline.stats->output_occupancy /= pipeline.stats->chunks;
+    }
+
+    // Clean up
+    for (i = 0; i < nchunks; i++) {
+        free(chunks[i].input.words);
+        free(chunks[i].output.words);
+    }
+    for (worker = 0; worker < config->workers; worker++) {
+        free(pipeline.input_rings[worker].slots);
+        free(pipeline.output_rings[worker].slots);
+    }
+    free(pipeline.free_ring.slots);
+    free(pipeline.input_rings);
+    free(pipeline.output_rings);
+    free(chunks);
+    free(workers);
+    free(threads);
+    if (!stats) {
+        pipeline_stats_free(&local_stats);
+    }
+
+    return result;
+}
+
+/// Prints one line of stage stats
+static void pipeline_report_stage(FILE *file, const char *name, const PipelineStageStats *stage, double elapsed) {
+    fprintf(file, "  %-10s %8.3f s busy (%5.1f%%) %10.3f Gbit/s\n", name, stage->seconds,
+            elapsed ? 100 * stage->seconds / elapsed : 0, stage->seconds ? stage->bits / stage->seconds / 1e9 : 0);
+}
+
+/// Prints the stage throughput and ring occupancy of a pipeline run
+void pipeline_report(const PipelineStats *stats, FILE *file) {
+    char name[32];
+    size_t worker;
+
+    fprintf(file, "Pipeline: %zu chunks in %.3f s (%.3f Gbit/s)\n", stats->chunks, stats->elapsed,
+            stats->elapsed ? stats->reader.bits / stats->elapsed / 1e9 : 0);
+
+    pipeline_report_stage(file, "reader", &stats->reader, stats->elapsed);
+    for (worker = 0; worker < stats->nworkers; worker++) {
+        snprintf(name, sizeof(name), "worker %zu", worker);
+        pipeline_report_stage(file, name, &stats->workers[worker], stats->elapsed);
+    }
+    pipeline_report_stage(file, "writer", &stats->writer, stats->elapsed);
+
+    fprintf(file, "  Waiting for workers: %.2f chunks on average, at most %zu\n", stats->input_occupancy,
+            stats->input_max);
+    fprintf(file, "  Waiting for writer:  %.2f chunks on average, at most %zu\n", stats->output_occupancy,
+            stats->output_max);
+}
+
+/// Frees memory allocated for pipeline stats
+void pipeline_stats_free(PipelineStats *stats) {
+    free(stats->workers);
+}
+
+/// Test work: the output is the input with every bit flipped
+static void pipeline_test_work(void *arg, BitStream *input, BitStream *output) {
+    size_t i;
+
+    bitstream_init(output, output->words, input->length);
+    for (i = 0; i < input->length; i++) {
+        bitstream_set(output, i, !bitstream_get(input, i));
+    }
+}
+
+/// Test emit: writes out the output of each chunk
+static void pipeline_test_emit(void *arg, const BitStream *input, const BitStream *output, BitWriter *writer) {
+    bitwriter_write(writer, output);
+}
+
+/// Checks that rings hand chunks over in order, and that a pipeline keeps its output in order with any number of
+/// workers
+void pipeline_test() {
+    PipelineConfig config;
+    PipelineStats stats;
+    PipelineRing ring;
+    PipelineChunk chunks[5], *taken;
+    BitReader reader;
+    BitWriter writer;
+    FILE *input, *output;
+    unsigned char *expected, byte;
+    size_t length, i, round;
+    int result, c;
+
+    printf("  => Testing pipeline functions\n");
+
+    // Wrap around the ring a few times
+    pipeline_ring_init(&ring, 5);
+    assert(ring.capacity == 8);
+    for (round = 0; round < 4; round++) {
+        for (i = 0; i < 5; i++) {
+            pipeline_ring_put(&ring, &chunks[i]);
+        }
+        for (i = 0; i < 5; i++) {
+            taken = pipeline_ring_take(&ring);
+            assert(taken == &chunks[i]);
+        }
+    }
+    free(ring.slots);
+
+    // Chunks that aren't whole bytes, so the writer has to stitch them together
+    length = 100000;
+    expected = (unsigned char*)malloc(length);
+    input = tmpfile();
+    for (i = 0; i < length; i++) {
+        byte = rand() & 0xff;
+        fputc(byte, input);
+        expected[i] = ~byte;
+    }
+
+    config.chunk_bits = 1001;
+    config.output_bits = 1001;
+    config.work = pipeline_test_work;
+    config.emit = pipeline_test_emit;
+    config.arg = NULL;
+
+    for (config.workers = 1; config.workers <= 4; config.workers++) {
+        rewind(input);
+        output = tmpfile();
+        bitreader_init(&reader, input, FORMAT_BIN, SIZE_MAX);
+        bitwriter_init(&writer, output, FORMAT_BIN);
+
+        result = pipeline_run(&config, &reader, &writer, &stats);
+        assert(result == 0);
+        assert(stats.chunks == (length * 8 + config.chunk_bits - 1) / config.chunk_bits);
+        assert(stats.reader.bits == length * 8 && stats.writer.bits == length * 8);
+        pipeline_stats_free(&stats);
+
+        bitwriter_finish(&writer);
+        bitreader_free(&reader);
+
+        rewind(output);
+        for (i = 0; i < length; i++) {
+            c = fgetc(output);
+            assert(c == expected[i]);
+        }
+        c = fgetc(output);
+        assert(c == EOF);
+        fclose(output);
+    }
+
+    fclose(input);
+    free(expected);
+
+    printf("    => Pipeline tests passed!\n");
+}
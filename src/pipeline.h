@@ -0,0 +1,73 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <bitio.h>
+
+/// Number of chunks in flight for each worker of a pipeline
+#define PIPELINE_DEPTH 4
+
+/// A buffer passed between the stages of a pipeline, reused once the writer is done with it
+typedef struct {
+    BitStream input;        // The chunk as read from the input
+    BitStream output;       // The result of the work on the chunk
+    int end;                // Set on the marker that follows the last chunk
+} PipelineChunk;
+
+/// Lock-free ring of chunks between one producer thread and one consumer thread
+typedef struct {
+    PipelineChunk **slots;
+    size_t capacity;                    // Always a power of two
+    _Alignas(64) atomic_size_t head;    // Next slot to take from (only written by the consumer)
+    _Alignas(64) atomic_size_t tail;    // Next slot to put into (only written by the producer)
+    size_t occupancy_total;             // Sum of the occupancy seen by each put, and the most seen
+    size_t occupancy_max;
+    size_t puts;
+} PipelineRing;
+
+/// What each stage of a pipeline does
+typedef struct {
+    size_t workers;         // Number of worker threads
+    size_t chunk_bits;      // Bits read into each chunk
+    size_t output_bits;     // Room needed for the output of a chunk
+    /// Turns the input of a chunk into its output, on a worker thread (it may change the input too)
+    void (*work)(void *arg, BitStream *input, BitStream *output);
+    /// Writes out a finished chunk, on the writer thread, in the same order the chunks were read
+    void (*emit)(void *arg, const BitStream *input, const BitStream *output, BitWriter *writer);
+    void *arg;
+} PipelineConfig;
+
+/// Time spent working (not waiting) by one stage, and the bits it got through
+typedef struct {
+    double seconds;
+    size_t bits;
+} PipelineStageStats;
+
+/// Measurements from a pipeline run, for sizing it
+typedef struct {
+    double elapsed;
+    size_t chunks;
+    PipelineStageStats reader, writer;      // The bits for every stage are message bits, so they can be compared
+    PipelineStageStats *workers;            // One per worker
+    size_t nworkers;
+    double input_occupancy, output_occupancy;   // Average chunks waiting in the worker input and output rings
+    size_t input_max, output_max;               // The most chunks seen waiting in one of them
+} PipelineStats;
+
+/// Reads chunks with the reader thread (this one), works on them with config->workers threads, and writes them in
+/// order with a writer thread. Returns 0 on success, -1 if the input was invalid, or -2 if the threads couldn't be
+/// started, in which case nothing has been read. If stats isn't NULL it's filled in, and its workers array needs
+/// freeing with pipeline_stats_free
+int pipeline_run(const PipelineConfig *config, BitReader *reader, BitWriter *writer, PipelineStats *stats);
+
+/// Prints the stage throughput and ring occupancy of a pipeline run
+void pipeline_report(const PipelineStats *stats, FILE *file);
+
+/// Frees memory allocated for pipeline stats
+void pipeline_stats_free(PipelineStats *stats);
+
+/// Tests all pipeline functions
+void pipeline_test();
+
+#endif // __PIPELINE_H__
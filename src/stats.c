@@ -0,0 +1,227 @@
+#include <stats.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Totals for one stage. They're atomic so the workers of a stream pipeline can all record into them
+typedef struct {
+    atomic_uint_least64_t cycles, bytes, allocs, calls;
+} StatsCounters;
+
+int stats_active = 0;
+
+#if STATS_ENABLED
+static const char *stats_stage_names[STATS_STAGES] = {
+    "parse", "hamming encode", "hamming fix", "hamming decode", "crc table", "crc encode", "crc verify", "format",
+    "output",
+};
+#endif
+
+static StatsCounters stats_stages[STATS_STAGES];
+
+// When recording started, by the cycle counter and the clock, so cycles can be turned into seconds
+static uint64_t stats_start_cycles;
+static double stats_start_seconds;
+
+// Latency of each message, in cycles
+static pthread_mutex_t stats_messages_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t *stats_messages = NULL;
+static size_t stats_message_count = 0, stats_message_capacity = 0;
+
+/// Returns the current time in seconds, from a monotonic clock
+static double stats_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// Turns on recording, and starts the clock the report's throughput is measured against
+void stats_start() {
+    stats_start_seconds = stats_now();
+    stats_start_cycles = stats_cycles();
+    stats_active = 1;
+}
+
+/// Adds the time and allocations since mark to a stage, along with the number of bytes it got through.
+/// Safe to call from several threads at once
+void stats_record(StatsStage stage, const StatsMark *mark, size_t bytes) {
+    StatsCounters *counters;
+
+    counters = &stats_stages[stage];
+    atomic_fetch_add_explicit(&counters->cycles, stats_cycles() - mark->cycles, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->bytes, bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->allocs, allocs_thread - mark->allocs, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->calls, 1, memory_order_relaxed);
+}
+
+/// Records the latency of one message, from mark until now
+void stats_record_message(const StatsMark *mark) {
+    uint64_t latency;
+
+    latency = stats_cycles() - mark->cycles;
+
+    pthread_mutex_lock(&stats_messages_lock);
+    if (stats_message_count == stats_message_capacity) {
+        stats_message_capacity = stats_message_capacity ? 2 * stats_message_capacity : 1024;
+        stats_messages = (uint64_t*)realloc(stats_messages, stats_message_capacity * sizeof(uint64_t));
+    }
+    stats_messages[stats_message_count++] = latency;
+    pthread_mutex_unlock(&stats_messages_lock);
+}
+
+/// Compares two latencies, for sorting
+static int stats_compare(const void *lhs, const void *rhs) {
+    uint64_t a, b;
+
+    a = *(const uint64_t*)lhs;
+    b = *(const uint64_t*)rhs;
+
+    return a < b ? -1 : a > b;
+}
+
+/// Returns the p-th percentile (0 < p <= 1, by nearest rank) of count sorted values
+static uint64_t stats_percentile(const uint64_t *sorted, size_t count, double p) {
+    size_t rank;
+
+    rank = (size_t)(p * count + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    return sorted[(rank > count ? count : rank) - 1];
+}
+
+/// Prints the time, throughput and allocations of each stage that ran, and the p50/p99 message latency if there was
+/// more than one message
+void stats_report(FILE *file) {
+#if STATS_ENABLED
+    StatsCounters *counters;
+    double elapsed, cycles_per_second, seconds;
+    uint64_t cycles, bytes;
+    size_t stage;
+
+    // The cycle counter doesn't have to tick at the cpu's clock rate, so it's measured against the wall clock
+    elapsed = stats_now() - stats_start_seconds;
+    cycles = stats_cycles() - stats_start_cycles;
+    cycles_per_second = elapsed > 0 ? cycles / elapsed : 1;
+
+    // The input is what was parsed, or in a stream pipeline (where the reader isn't timed) what was worked on
+    bytes = atomic_load(&stats_stages[STATS_PARSE].bytes);
+    for (stage = STATS_HAMMING_ENCODE; !bytes && stage < STATS_FORMAT; stage++) {
+        if (stage != STATS_CRC_TABLE) {
+            bytes = atomic_load(&stats_stages[stage].bytes);
+        }
+    }
+    fprintf(file, "Stats: %.6f s in total, %.3f Gbit/s of input\n", elapsed,
+            elapsed > 0 ? bytes * 8 / elapsed / 1e9 : 0);
+    fprintf(file, "  %-15s %8s %14s %11s %14s %10s %10s\n", "stage", "calls", "cycles", "seconds", "bytes", "Gbit/s",
+            "allocs");
+
+    for (stage = 0; stage < STATS_STAGES; stage++) {
+        counters = &stats_stages[stage];
+        if (!atomic_load(&counters->calls)) {
+            continue;
+        }
+
+        seconds = atomic_load(&counters->cycles) / cycles_per_second;
+        fprintf(file, "  %-15s %8llu %14llu %11.6f %14llu %10.3f %10llu\n", stats_stage_names[stage],
+                (unsigned long long)atomic_load(&counters->calls), (unsigned long long)atomic_load(&counters->cycles),
+                seconds, (unsigned long long)atomic_load(&counters->bytes),
+                seconds > 0 ? atomic_load(&counters->bytes) * 8 / seconds / 1e9 : 0,
+                (unsigned long long)atomic_load(&counters->allocs));
+    }
+
+    if (stats_message_count > 1) {
+        qsort(stats_messages, stats_message_count, sizeof(uint64_t), stats_compare);
+        fprintf(file, "  %zu messages, latency p50 %.3f us, p99 %.3f us\n", stats_message_count,
+                stats_percentile(stats_messages, stats_message_count, 0.5) / cycles_per_second * 1e6,
+                stats_percentile(stats_messages, stats_message_count, 0.99) / cycles_per_second * 1e6);
+    }
+#else
+    fprintf(file, "Stats: not available (the program was built with STATS_ENABLED=0)\n");
+#endif
+}
+
+/// Clears everything recorded, and turns recording off
+void stats_reset() {
+    size_t stage;
+
+    stats_active = 0;
+    for (stage = 0; stage < STATS_STAGES; stage++) {
+        atomic_store(&stats_stages[stage].cycles, 0);
+        atomic_store(&stats_stages[stage].bytes, 0);
+        atomic_store(&stats_stages[stage].allocs, 0);
+        atomic_store(&stats_stages[stage].calls, 0);
+    }
+
+    free(stats_messages);
+    stats_messages = NULL;
+    stats_message_count = 0;
+    stats_message_capacity = 0;
+}
+
+/// Tests all stats functions
+void stats_test() {
+    uint64_t values[100];
+    StatsMark mark;
+    FILE *file;
+    char line[256];
+    size_t i, found;
+
+    printf("  => Testing stats functions\n");
+
+    // Percentiles by nearest rank
+    for (i = 0; i < 100; i++) {
+        values[i] = i + 1;
+    }
+    assert(stats_percentile(values, 100, 0.5) == 50);
+    assert(stats_percentile(values, 100, 0.99) == 99);
+    assert(stats_percentile(values, 100, 1) == 100);
+    assert(stats_percentile(values, 1, 0.5) == 1);
+    assert(stats_percentile(values, 3, 0.99) == 3);
+
+    // Sorting latencies
+    for (i = 0; i < 100; i++) {
+        values[i] = (i * 37) % 100;
+    }
+    qsort(values, 100, sizeof(uint64_t), stats_compare);
+    for (i = 0; i < 100; i++) {
+        assert(values[i] == i);
+    }
+
+    // Stages add up their calls and bytes, and show up in the report along with the latency of the messages
+    stats_reset();
+    stats_start();
+    for (i = 0; i < 10; i++) {
+        mark.cycles = stats_cycles();
+        mark.allocs = allocs_thread;
+        stats_record(STATS_HAMMING_ENCODE, &mark, 100);
+        stats_record_message(&mark);
+    }
+    assert(atomic_load(&stats_stages[STATS_HAMMING_ENCODE].calls) == 10);
+    assert(atomic_load(&stats_stages[STATS_HAMMING_ENCODE].bytes) == 1000);
+    assert(atomic_load(&stats_stages[STATS_PARSE].calls) == 0);
+    assert(stats_message_count == 10);
+
+    file = tmpfile();
+    assert(file);
+    stats_report(file);
+    rewind(file);
+    found = 0;
+    while (fgets(line, sizeof(line), file)) {
+        found += strstr(line, "hamming encode") != NULL;
+        found += strstr(line, "10 messages") != NULL;
+        assert(!strstr(line, "parse"));
+    }
+    fclose(file);
+    assert(found == (STATS_ENABLED ? 2 : 0));
+
+    stats_reset();
+    assert(!stats_active);
+    assert(stats_message_count == 0);
+
+    printf("    => Stats tests passed!\n");
+}
@@ -0,0 +1,97 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <allocs.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Build with -DSTATS_ENABLED=0 to compile all of the instrumentation out (--stats then only says so)
+#ifndef STATS_ENABLED
+#define STATS_ENABLED 1
+#endif
+
+/// The stages of a run that are timed separately
+typedef enum {
+    STATS_PARSE,            // Reading the input (and generator) into bitstreams
+    STATS_HAMMING_ENCODE,
+    STATS_HAMMING_FIX,
+    STATS_HAMMING_DECODE,
+    STATS_CRC_TABLE,        // Building the crc table for a generator
+    STATS_CRC_ENCODE,
+    STATS_CRC_VERIFY,       // Checking (and fixing) received crc frames
+    STATS_FORMAT,           // Turning the result into text
+    STATS_OUTPUT,           // Writing the result out
+    STATS_STAGES
+} StatsStage;
+
+/// The start of a timed region: the cycle counter, and the number of allocations the thread had made
+typedef struct {
+    uint64_t cycles;
+    size_t allocs;
+} StatsMark;
+
+/// Set by stats_start, so the instrumentation costs a single branch when --stats wasn't given
+extern int stats_active;
+
+/// Reads the cycle counter (or a nanosecond clock where there isn't one)
+static inline uint64_t stats_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/// Turns on recording, and starts the clock the report's throughput is measured against
+void stats_start();
+/// Adds the time and allocations since mark to a stage, along with the number of bytes it got through.
+/// Safe to call from several threads at once
+void stats_record(StatsStage stage, const StatsMark *mark, size_t bytes);
+/// Records the latency of one message, from mark until now
+void stats_record_message(const StatsMark *mark);
+/// Prints the time, throughput and allocations of each stage that ran, and the p50/p99 message latency if there was
+/// more than one message
+void stats_report(FILE *file);
+/// Clears everything recorded, and turns recording off
+void stats_reset();
+
+#if STATS_ENABLED
+/// Starts timing a region
+#define STATS_MARK(mark) do { \
+        if (stats_active) { \
+            (mark).cycles = stats_cycles(); \
+            (mark).allocs = allocs_thread; \
+        } \
+    } while (0)
+/// Adds the region started by mark to a stage
+#define STATS_RECORD(stage, mark, bytes) do { \
+        if (stats_active) { \
+            stats_record((stage), &(mark), (bytes)); \
+        } \
+    } while (0)
+/// Records the region started by mark as the latency of one message
+#define STATS_MESSAGE(mark) do { \
+        if (stats_active) { \
+            stats_record_message(&(mark)); \
+        } \
+    } while (0)
+#else
+#define STATS_MARK(mark) ((void)(mark))
+#define STATS_RECORD(stage, mark, bytes) ((void)(mark))
+#define STATS_MESSAGE(mark) ((void)(mark))
+#endif
+
+/// Tests all stats functions
+void stats_test();
+
+#endif // __STATS_H__